@@ -0,0 +1,242 @@
+/*!
+ * Benchmark the Mobius request path
+ *
+ * This example measures the library without any Mobius devices (or a radio)
+ * by connecting a MobiusDevice to a MobiusSimulator. First this will time the
+ * CRC, then send batches of requests with different simulated latencies, drop
+ * rates and fragment sizes, reporting the frames per second, per request
+ * latency percentiles and free memory. Finally a captured session is
+ * replayed, timing how long the device takes to handle each fragment.
+ * Run it before and after a change to catch performance regressions, on
+ * a board or on a host with the build in extras/host.
+ *
+ * The circuit:
+ * - Any Arduino board supported by ArduinoBLE.
+ *
+ * This example code is released into the public domain.
+ */
+
+#include <ArduinoBLE.h>
+#include <MobiusBLE.h>
+#include <MobiusSimulator.h>
+#include <MobiusReplay.h>
+
+#if defined(__arm__)
+extern "C" char* sbrk(int incr);
+#elif defined(__AVR__)
+extern char* __brkval;
+extern char __heap_start;
+#endif
+
+// number of requests sent per benchmark
+#define REQUEST_COUNT 100
+// number of requests captured for the replay
+#define REPLAY_COUNT 8
+
+// define the simulated device and the MobiusDevice talking to it
+MobiusSimulator simulator;
+MobiusDevice device = MobiusDevice("00:00:00:00:00:00");
+
+// latency of each request of the current benchmark
+unsigned long latencies[REQUEST_COUNT];
+// number of pipelined requests completed
+uint8_t completed = 0;
+// ring buffer capturing a session and the copy replayed
+uint8_t capture[512];
+uint8_t session[512];
+
+/*!
+ * Main Setup method
+ */
+void setup() {
+  // connect the serial port for logs
+  Serial.begin(9600);
+  while (!Serial);
+
+  // talk to the simulated device instead of the radio
+  MobiusDevice::responseTimeout = 100;
+  device.setTransport(&simulator);
+  device.connect();
+
+  Serial.print("Free memory: ");
+  Serial.println(freeMemory());
+  Serial.print("Device size: ");
+  Serial.println(sizeof(MobiusDevice));
+  benchmarkCrc();
+
+  // the simulated device answers straight away
+  benchmarkRequests("Immediate", 0, 0, 0);
+  // responses spread over 20 byte RX_DATA fragments
+  benchmarkRequests("Fragmented", 0, 0, 20);
+  // a typical 7.5 ms connection interval with lost responses
+  benchmarkRequests("Lossy", 7500, 5, 0);
+  benchmarkPipelined();
+  benchmarkReplay();
+
+  Serial.print("Free memory: ");
+  Serial.println(freeMemory());
+  Serial.println("Benchmark complete");
+}
+
+/*!
+ * Main Loop method
+ */
+void loop() {
+  // nothing left to do
+}
+
+/*!
+ * Time the CRC of a full request frame
+ */
+void benchmarkCrc() {
+  uint8_t frame[MOBIUS_MAX_REQUEST_SIZE];
+  for (uint16_t i = 0; i < sizeof frame; i++) {
+    frame[i] = i;
+  }
+  uint16_t crc = 0;
+  unsigned long startMicros = micros();
+  for (uint16_t i = 0; i < 1000; i++) {
+    // feed each CRC back so none can be skipped
+    crc = MobiusCRC::crc16(frame, sizeof frame);
+    frame[0] = crc;
+  }
+  unsigned long elapsed = micros() - startMicros;
+  Serial.print("CRC: ");
+  Serial.print(1000.0 * sizeof frame / elapsed, 3);
+  Serial.print(" MB/s (0x");
+  Serial.print(crc, HEX);
+  Serial.println(")");
+}
+
+/*!
+ * Send REQUEST_COUNT scene changes one after the other to a simulated
+ * device with the given 'latency', 'dropRate' and 'fragmentSize'
+ */
+void benchmarkRequests(const char* name, unsigned long latency, uint8_t dropRate, uint8_t fragmentSize) {
+  simulator.setLatency(latency);
+  simulator.setDropRate(dropRate);
+  simulator.setFragmentSize(fragmentSize);
+  device.resetStats();
+
+  uint16_t failed = 0;
+  unsigned long startMicros = micros();
+  for (uint16_t i = 0; i < REQUEST_COUNT; i++) {
+    unsigned long requestMicros = micros();
+    if (!device.setScene(i)) {
+      failed++;
+    }
+    latencies[i] = micros() - requestMicros;
+  }
+  printResults(name, micros() - startMicros, REQUEST_COUNT, failed);
+}
+
+/*!
+ * Send REQUEST_COUNT scene changes, keeping MOBIUS_MAX_IN_FLIGHT in flight
+ */
+void benchmarkPipelined() {
+  simulator.setLatency(7500);
+  simulator.setDropRate(0);
+  simulator.setFragmentSize(0);
+  device.resetStats();
+
+  uint16_t sent = 0;
+  completed = 0;
+  unsigned long startMicros = micros();
+  while (completed < REQUEST_COUNT) {
+    while (sent < REQUEST_COUNT && device.beginSetScene(sent, requestCompleted)) {
+      sent++;
+    }
+    device.poll();
+  }
+  // per request latencies aren't tracked while pipelining
+  latencies[0] = device.stats().confirm.averageMicros();
+  printResults("Pipelined", micros() - startMicros, 1, device.stats().requestsFailed);
+}
+
+/*!
+ * Capture REPLAY_COUNT scene changes received in 8 byte fragments,
+ * then replay them and time the handling of the fragments
+ */
+void benchmarkReplay() {
+  simulator.setLatency(0);
+  simulator.setDropRate(0);
+  simulator.setFragmentSize(8);
+  MobiusCapture::begin(capture, sizeof capture);
+  for (uint8_t i = 0; i < REPLAY_COUNT; i++) {
+    device.setScene(i);
+  }
+  uint16_t size = MobiusCapture::copy(session, sizeof session);
+  MobiusCapture::end();
+
+  // play the captured device side back to the device
+  MobiusReplay replay(session, size);
+  device.disconnect();
+  device.setTransport(&replay);
+  device.connect();
+  device.resetStats();
+  replay.run(device);
+  Serial.print("Replay: ");
+  Serial.print(replay.requests());
+  Serial.print(" requests, RX_DATA us avg:");
+  Serial.print(replay.dataTiming().averageMicros());
+  Serial.print(" RX_FINAL us avg:");
+  Serial.print(replay.finalTiming().averageMicros());
+  Serial.print(" failed:");
+  Serial.println(device.stats().requestsFailed);
+
+  // back to the simulated device
+  device.disconnect();
+  device.setTransport(&simulator);
+  device.connect();
+}
+
+/*!
+ * Request handler counting the completed requests
+ */
+void requestCompleted(MobiusDevice& /*device*/, bool /*successful*/, MobiusSpan /*data*/) {
+  completed++;
+}
+
+/*!
+ * Print the frames per second and percentiles of the first 'count' latencies
+ */
+void printResults(const char* name, unsigned long elapsed, uint16_t count, uint16_t failed) {
+  // sort the latencies to find the percentiles
+  for (uint16_t i = 1; i < count; i++) {
+    unsigned long latency = latencies[i];
+    uint16_t j = i;
+    for (; 0 < j && latencies[j - 1] > latency; j--) {
+      latencies[j] = latencies[j - 1];
+    }
+    latencies[j] = latency;
+  }
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(1000000.0 * REQUEST_COUNT / elapsed, 1);
+  Serial.print(" frames/s, latency us p50:");
+  Serial.print(latencies[count / 2]);
+  Serial.print(" p90:");
+  Serial.print(latencies[count * 9 / 10]);
+  Serial.print(" p99:");
+  Serial.print(latencies[count * 99 / 100]);
+  Serial.print(" max:");
+  Serial.print(latencies[count - 1]);
+  Serial.print(" failed:");
+  Serial.println(failed);
+}
+
+/*!
+ * Number of bytes between the heap and the stack
+ */
+int freeMemory() {
+#if defined(__arm__)
+  char top;
+  return &top - sbrk(0);
+#elif defined(__AVR__)
+  char top;
+  return __brkval ? &top - __brkval : &top - &__heap_start;
+#else
+  // not known here, the host build (extras/host) reports the heap used instead
+  return 0;
+#endif
+}
@@ -3,9 +3,10 @@
  *
  * This example shows how a Mobius device may be controlled with an analog signal.
  * First this will scans for BLE enabled Mobius devices (expecting just one). Once
- * the device is discovered this checks the analog PIN (A0) every 2 seconds for the
- * current state. When a new state is detected this will connect to the Mobius
- * device and set the scene corresponding to the state.
+ * the device is discovered this begins a session which keeps the device connected
+ * and checks the analog PIN (A0) every 2 seconds for the current state. When a new
+ * state is detected this will queue setting the scene corresponding to the state,
+ * so a flapping input only sends the latest scene.
  * 
  * The circuit:
  * - Arduino Nano 33 BLE, or Arduino Nano 33 BLE Sense board
@@ -32,6 +33,10 @@ const int SENSOR_PIN = A0;
 byte currentState = 0;
 // define a variable for the MobiusDevice to be controlled
 MobiusDevice pump;
+// define a queue of the scene changes waiting to be sent to the pump
+MobiusQueue commands(pump);
+// define a variable for the last time the state was checked
+unsigned long checkMillis = 0;
 
 /*!
  * Main Setup method
@@ -40,7 +45,9 @@ void setup() {
   // connect the serial port for logs
   Serial.begin(9600);
   while (!Serial);
-  
+  // log connection and request progress
+  MobiusTrace::setSink(MobiusTrace::serialSink);
+
   // allow the ADC to be as precise a possible
   analogReadResolution(12);
   
@@ -68,14 +75,22 @@ void setup() {
   MobiusDevice::blueLed = BLUE_LED;
   MobiusDevice::greenLed = GREEN_LED;
 
-  // define a String buffer to hold found Mobius device addresses
-  String addressBuffer[5];
+  // define a buffer to hold found Mobius device addresses
+  MobiusAddress addressBuffer[5];
 
-  // find nearby Mobius devices
-  int count = 0;
-  while (!count) {
-    count = MobiusDevice::scanForMobiusDevices(addressBuffer);
+  // start with the devices connected before the reset, this needs
+  // the MobiusCache to be persisted (see MobiusCache::setStorage())
+  int count = MobiusDevice::knownMobiusDevices(addressBuffer, 5);
+  if (!count) {
+    // otherwise find nearby Mobius devices
+    while (!count) {
+      count = MobiusDevice::scanForMobiusDevices(addressBuffer, 5);
+    }
+    // reset the BLE initialization
+    BLE.begin();
   }
+  // keep the scanner registry fresh, so connecting skips the scan
+  MobiusScanner::begin();
 
   // check all the devices were found
   int expectedDevices = 1;
@@ -85,9 +100,9 @@ void setup() {
   
   // initialize the device to be contolled
   pump = MobiusDevice(addressBuffer[0]);
-  
-  // reset the BLE initialization
-  BLE.begin();
+
+  // keep the device connected between scene changes
+  pump.beginSession();
 }
 
 
@@ -95,39 +110,42 @@ void setup() {
  * Main Loop method
  */
 void loop() {
+  // send queued scene changes and keep the session connected
+  // (reconnects if the connection was lost)
+  commands.poll();
+
+  // check the state every 2 seconds
+  if (2000 > (millis() - checkMillis)) {
+    return;
+  }
+  checkMillis = millis();
+
   // get the analog state
   byte newState = analogState();
 
   if (currentState != newState) {
     // now in a different state, update a maybe do something
-    if (1 == newState && pump.connect()) {
+    if (1 == newState) {
       Serial.println("Feed Mode");
-      // new state is the feed state AND the device is connected
-      if(pump.setFeedScene()) {
+      // new state is the feed state, feeding goes before anything else queued
+      if (commands.setFeedScene()) {
         // update the current state so not to re-enter feed state next loop
         currentState = newState;
       }
-      // disconnect from the device
-      pump.disconnect();
-    } else if (2 == newState && pump.connect()) {
+    } else if (2 == newState) {
       Serial.println("Maintenance Mode");
-      // new state is the maintenance state AND the device is connected
-      // set the sceneId to the custom/unique ID
+      // new state is the maintenance state
+      // set the sceneId to the custom/unique ID, replacing a queued scene change
       uint16_t sceneId = 1234;
-      if(pump.setScene(sceneId)) {
+      if (commands.setScene(sceneId)) {
         // update the current state so not to re-enter maintenance state next loop
         currentState = newState;
       }
-      // disconnect from the device
-      pump.disconnect();
-    } else {
+    } else if (0 == newState) {
       // update the current state
       currentState = newState;
     }
   }
-  
-  // wait/sleep for 2 seconds before checking the state again
-  delay(2000);
 }
 
 /*!
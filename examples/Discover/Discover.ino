@@ -21,8 +21,8 @@
 #include <ArduinoBLE.h>
 #include <MobiusBLE.h>
 
-// define a String buffer to hold found Mobius device addresses
-String addressBuffer[10];
+// define a buffer to hold found Mobius device addresses
+MobiusAddress addressBuffer[10];
 
 /*!
  * Main Setup method
@@ -46,7 +46,7 @@ void setup() {
   // find nearby Mobius devices
   int count = 0;
   while (!count) {
-    count = MobiusDevice::scanForMobiusDevices(addressBuffer);
+    count = MobiusDevice::scanForMobiusDevices(addressBuffer, 10);
   }
 
   // check all the devices were found
@@ -104,9 +104,34 @@ void loop() {
     }
   }
 
+  // show where the time went
+  const MobiusDevice::Stats& stats = device.stats();
+  printTiming("Connect", stats.connect);
+  printTiming("Discover", stats.discover);
+  printTiming("Subscribe", stats.subscribe);
+  printTiming("Confirm", stats.confirm);
+  Serial.print("Requests successful:");
+  Serial.print(stats.requestsSuccessful);
+  Serial.print(" failed:");
+  Serial.println(stats.requestsFailed);
+  Serial.print("Awake (%):");
+  Serial.println(stats.dutyCycle());
+
   Serial.println("Discovering complete");
   while (1) { 
     // stop discovering
   }
 }
 
+/*!
+ * Print the min/avg/max of the given 'timing' in milliseconds
+ */
+void printTiming(const char* phase, const MobiusDevice::Timing& timing) {
+  Serial.print(phase);
+  Serial.print(" ms min:");
+  Serial.print(timing.minMicros / 1000.0);
+  Serial.print(" avg:");
+  Serial.print(timing.averageMicros() / 1000.0);
+  Serial.print(" max:");
+  Serial.println(timing.maxMicros / 1000.0);
+}
@@ -0,0 +1,110 @@
+/*!
+ * Control a Fleet of Mobius Devices
+ *
+ * This example shows how multiple Mobius devices may be controlled together.
+ * First this will scan for BLE enabled Mobius devices and add every found device
+ * (up to MOBIUS_MAX_CONNECTIONS) to a fleet which keeps them all connected. Then
+ * every minute this will alternate between starting the default feed "scene" and
+ * the normal schedule on all the devices at once. The feed scene is prepared
+ * ahead of time and committed to all devices together, reporting how far apart
+ * the devices started.
+ *
+ * The circuit:
+ * - Arduino MKR WiFi 1010, Arduino Uno WiFi Rev2 board, Arduino Nano 33 IoT,
+ *   Arduino Nano 33 BLE, or Arduino Nano 33 BLE Sense board.
+ *
+ * This example code is released into the public domain.
+ */
+
+#include <ArduinoBLE.h>
+#include <MobiusBLE.h>
+
+// define a buffer to hold found Mobius device addresses
+MobiusAddress addressBuffer[10];
+// define the MobiusDevices to be controlled and the fleet controlling them
+MobiusDevice devices[MOBIUS_MAX_CONNECTIONS];
+MobiusFleet fleet;
+
+// define variables for the current mode and when it was started
+bool feeding = false;
+unsigned long modeMillis = 0;
+
+/*!
+ * Main Setup method
+ */
+void setup() {
+  // connect the serial port for logs
+  Serial.begin(9600);
+  while (!Serial);
+  // log connection and request progress
+  MobiusTrace::setSink(MobiusTrace::serialSink);
+
+  // begin BLE initialization
+  if (!BLE.begin()) {
+   Serial.println("Failed to initialize BLE");
+    while (1) {
+      // do not continue without BLE
+    }
+  }
+
+  // start with the devices connected before the reset, this needs
+  // the MobiusCache to be persisted (see MobiusCache::setStorage())
+  int count = MobiusDevice::knownMobiusDevices(addressBuffer, 10);
+  if (!count) {
+    // otherwise find nearby Mobius devices
+    while (!count) {
+      count = MobiusDevice::scanForMobiusDevices(addressBuffer, 10);
+    }
+    // reset the BLE initialization
+    BLE.begin();
+  }
+  // keep the scanner registry fresh, so connecting skips the scan
+  MobiusScanner::begin();
+
+  // add the found devices to the fleet
+  for (int i = 0; i < count && i < MOBIUS_MAX_CONNECTIONS; i++) {
+    devices[i] = MobiusDevice(addressBuffer[i]);
+    fleet.add(devices[i]);
+  }
+
+  // keep all the devices connected
+  int connected = fleet.beginSession();
+  Serial.print("Connected devices:");
+  Serial.println(connected);
+}
+
+
+/*!
+ * Main Loop method
+ */
+void loop() {
+  // keep the sessions connected
+  fleet.poll();
+
+  // switch modes every minute
+  if (60000 > (millis() - modeMillis)) {
+    return;
+  }
+  modeMillis = millis();
+  feeding = !feeding;
+
+  if (feeding) {
+    // build every request up front, then write them back to back
+    fleet.prepareSetFeedScene();
+    int successful = fleet.commit();
+    Serial.print("Feed scene set on ");
+    Serial.print(successful);
+    Serial.print(" devices, skew (us):");
+    for (uint8_t i = 0; i < fleet.size(); i++) {
+      Serial.print(" ");
+      Serial.print(fleet.skew(i));
+    }
+    Serial.println();
+    return;
+  }
+  // send the request to every device before waiting for any response
+  int successful = fleet.runSchedule();
+  Serial.print("Schedule running on ");
+  Serial.print(successful);
+  Serial.println(" devices");
+}
@@ -0,0 +1,60 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ *
+ * Runs the Benchmark example on the host, reporting the heap used
+ * alongside its results.
+ */
+
+#include <cstdio>
+#include <new>
+#include <Arduino.h>
+#include <MobiusSpan.h>
+
+class MobiusDevice;
+
+// prototypes the Arduino IDE generates for the sketch
+void setup();
+void loop();
+void benchmarkCrc();
+void benchmarkRequests(const char* name, unsigned long latency, uint8_t dropRate, uint8_t fragmentSize);
+void benchmarkPipelined();
+void benchmarkReplay();
+void requestCompleted(MobiusDevice& device, bool successful, MobiusSpan data);
+void printResults(const char* name, unsigned long elapsed, uint16_t count, uint16_t failed);
+int freeMemory();
+
+#include "../../examples/Benchmark/Benchmark.ino"
+
+// heap use of the whole run, every allocation carries its size in front
+static size_t heapAllocations = 0;
+static size_t heapBytes = 0;
+static size_t heapPeakBytes = 0;
+
+void* operator new(size_t size) {
+    size_t* block = (size_t*)malloc(sizeof(size_t) + size);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *block = size;
+    heapAllocations++;
+    heapBytes += size;
+    heapPeakBytes = (heapBytes > heapPeakBytes) ? heapBytes : heapPeakBytes;
+    return block + 1;
+}
+void operator delete(void* pointer) noexcept {
+    if (pointer) {
+        size_t* block = (size_t*)pointer - 1;
+        heapBytes -= *block;
+        free(block);
+    }
+}
+void operator delete(void* pointer, size_t /*size*/) noexcept {
+    operator delete(pointer);
+}
+
+int main() {
+    setup();
+    printf("Heap: %zu allocations, %zu bytes at the peak, %zu bytes left\n",
+        heapAllocations, heapPeakBytes, heapBytes);
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ *
+ * Replays a session copied from MobiusCapture (see MobiusCapture::copy())
+ * through a MobiusDevice on the host:
+ *
+ *     replay [-l] [capture]
+ *
+ * With -l every fragment is delivered as late as it was received. Without
+ * a capture file a session with a MobiusSimulator is captured first. Exits
+ * with 1 if a request failed or didn't match its recording, so a known good
+ * capture catches regressions of the response path.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <MobiusBLE.h>
+#include <MobiusSimulator.h>
+#include <MobiusReplay.h>
+
+// largest capture a MobiusReplay can play
+static uint8_t session[0xFFFF];
+
+/*!
+ * Capture a few scene changes and reads from a simulated device,
+ * received in 8 byte fragments, into the session.
+ *
+ * @return the size of the session
+ */
+static uint16_t captureSession(MobiusDevice& device) {
+    static uint8_t capture[2048];
+    MobiusSimulator simulator;
+    simulator.setFragmentSize(8);
+    device.setTransport(&simulator);
+    MobiusCapture::begin(capture, sizeof capture);
+    device.connect();
+    for (uint16_t sceneId = 0; sceneId < 8; sceneId++) {
+        device.setScene(sceneId);
+        device.getCurrentScene();
+    }
+    device.disconnect();
+    uint16_t size = MobiusCapture::copy(session, sizeof session);
+    MobiusCapture::end();
+    return size;
+}
+
+/*!
+ * Read the session from the file at the given 'path'.
+ *
+ * @return the size of the session, 0 if it couldn't be read
+ */
+static uint16_t readSession(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return 0;
+    }
+    size_t size = fread(session, 1, sizeof session, file);
+    // too large to replay in one go
+    bool complete = feof(file) && !ferror(file);
+    fclose(file);
+    return complete ? size : 0;
+}
+
+int main(int argc, char** argv) {
+    bool recordedLatency = 1 < argc && 0 == strcmp("-l", argv[1]);
+    const char* path = (1 + recordedLatency < argc) ? argv[1 + recordedLatency] : nullptr;
+    MobiusDevice device = MobiusDevice("00:00:00:00:00:00");
+    uint16_t size = path ? readSession(path) : captureSession(device);
+    if (!size) {
+        fprintf(stderr, "%s: can't read the capture\n", path ? path : "simulator");
+        return 2;
+    }
+
+    MobiusReplay replay(session, size);
+    replay.setRecordedLatency(recordedLatency);
+    device.setTransport(&replay);
+    device.connect();
+    device.resetStats();
+    replay.run(device);
+
+    const MobiusDevice::Stats& stats = device.stats();
+    printf("Replay: %u bytes, %u requests, %u mismatched\n", size, replay.requests(), replay.mismatches());
+    printf("RX_DATA us min:%lu avg:%lu max:%lu\n", (unsigned long)replay.dataTiming().minMicros,
+        (unsigned long)replay.dataTiming().averageMicros(), (unsigned long)replay.dataTiming().maxMicros);
+    printf("RX_FINAL us min:%lu avg:%lu max:%lu\n", (unsigned long)replay.finalTiming().minMicros,
+        (unsigned long)replay.finalTiming().averageMicros(), (unsigned long)replay.finalTiming().maxMicros);
+    printf("Requests successful:%lu failed:%lu timeouts:%lu CRC errors:%lu\n", (unsigned long)stats.requestsSuccessful,
+        (unsigned long)stats.requestsFailed, (unsigned long)stats.timeouts, (unsigned long)stats.crcErrors);
+    return (replay.mismatches() || stats.requestsFailed) ? 1 : 0;
+}
@@ -0,0 +1,108 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ *
+ * The parts of the Arduino core the library uses, for building it on a host
+ * (see extras/host). Time is taken from the host's monotonic clock.
+ */
+
+#ifndef _Arduino_h
+#define _Arduino_h
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+typedef uint8_t byte;
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+#define DEC 10
+#define HEX 16
+#define A0 14
+
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+long random(long howbig);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int analogRead(uint8_t pin);
+void analogReadResolution(int bits);
+
+/*!
+ * @brief Arduino String, backed by a std::string.
+ */
+class String {
+public:
+    String() { }
+    String(const char* text) : _text(text ? text : "") { }
+
+    const char* c_str() const { return _text.c_str(); }
+    unsigned int length() const { return _text.size(); }
+    bool isEmpty() const { return _text.empty(); }
+    char charAt(unsigned int index) const { return _text[index]; }
+    char operator[](unsigned int index) const { return _text[index]; }
+    bool operator==(const String& other) const { return _text == other._text; }
+    bool operator!=(const String& other) const { return _text != other._text; }
+    bool equalsIgnoreCase(const String& other) const;
+    void toLowerCase();
+    void reserve(unsigned int size) { _text.reserve(size); }
+    String& operator+=(char c) { _text += c; return *this; }
+    String& operator+=(const char* text) { _text += text; return *this; }
+
+private:
+    std::string _text;
+};
+
+/*!
+ * @brief Arduino Print, the subset the library and its examples use.
+ */
+class Print {
+public:
+    virtual ~Print() { }
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+
+    size_t print(const char* text);
+    size_t print(const String& text);
+    size_t print(char c);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+    size_t println();
+    template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+    template <typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+/*!
+ * @brief Arduino Stream, without any input.
+ */
+class Stream : public Print {
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+};
+
+/*!
+ * @brief Serial port writing to the standard output.
+ */
+class HostSerial : public Stream {
+public:
+    void begin(unsigned long /*baud*/) { }
+    operator bool() { return true; }
+    size_t write(uint8_t b) override;
+    using Print::write;
+};
+
+extern HostSerial Serial;
+
+#endif
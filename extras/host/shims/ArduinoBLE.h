@@ -0,0 +1,117 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ *
+ * The parts of ArduinoBLE 1.2.1 the library uses, for building it on a host
+ * (see extras/host). There is no radio: scans find nothing and connections
+ * fail, so devices are driven through a MobiusTransport.
+ */
+
+#ifndef _ARDUINO_BLE_H_
+#define _ARDUINO_BLE_H_
+
+#include <Arduino.h>
+
+enum BLEDeviceEvent {
+    BLEConnected = 0,
+    BLEDisconnected = 1,
+    BLEDiscovered = 2,
+    BLEDeviceLastEvent
+};
+
+enum BLECharacteristicEvent {
+    BLESubscribed = 0,
+    BLEUnsubscribed = 1,
+    BLERead = 2,
+    BLEWritten = 3,
+    BLEUpdated = BLEWritten,
+    BLECharacteristicEventLast
+};
+
+class BLEDevice;
+class BLECharacteristic;
+
+typedef void (*BLEDeviceEventHandler)(BLEDevice device);
+typedef void (*BLECharacteristicEventHandler)(BLEDevice device, BLECharacteristic characteristic);
+
+/*!
+ * @brief Characteristic of a remote device, never valid on a host.
+ */
+class BLECharacteristic {
+public:
+    operator bool() const { return false; }
+    uint8_t properties() const { return 0; }
+    const char* uuid() const { return ""; }
+    int valueSize() const { return 0; }
+    const uint8_t* value() const { return nullptr; }
+    int valueLength() const { return 0; }
+    int readValue(uint8_t /*value*/[], int /*length*/) { return 0; }
+    int readValue(void* /*value*/, int /*length*/) { return 0; }
+    int writeValue(const uint8_t /*value*/[], int /*length*/) { return 0; }
+    int writeValue(const void* /*value*/, int /*length*/) { return 0; }
+    bool canRead() { return false; }
+    bool read() { return false; }
+    bool canWrite() { return false; }
+    bool canSubscribe() { return false; }
+    bool subscribe() { return false; }
+    bool canUnsubscribe() { return false; }
+    bool unsubscribe() { return false; }
+    bool valueUpdated() { return false; }
+    void setEventHandler(int /*event*/, BLECharacteristicEventHandler /*eventHandler*/) { }
+};
+
+/*!
+ * @brief Remote device, never connected on a host.
+ */
+class BLEDevice {
+public:
+    virtual ~BLEDevice() { }
+    virtual void poll() { }
+    virtual void poll(unsigned long /*timeout*/) { }
+    virtual bool connected() const { return false; }
+    virtual bool disconnect() { return true; }
+    virtual String address() const { return String(); }
+    bool hasLocalName() const { return false; }
+    String localName() const { return String(); }
+    bool hasAdvertisedServiceUuid() const { return false; }
+    int rssi() { return 0; }
+    bool connect() { return false; }
+    bool discoverAttributes() { return false; }
+    bool discoverService(const char* /*serviceUuid*/) { return false; }
+    virtual operator bool() const { return false; }
+    virtual bool operator==(const BLEDevice& /*rhs*/) const { return true; }
+    virtual bool operator!=(const BLEDevice& /*rhs*/) const { return false; }
+    int characteristicCount() const { return 0; }
+    BLECharacteristic characteristic(int /*index*/) const { return BLECharacteristic(); }
+    BLECharacteristic characteristic(const char* /*uuid*/) const { return BLECharacteristic(); }
+    BLECharacteristic characteristic(const char* /*uuid*/, int /*index*/) const { return BLECharacteristic(); }
+    bool hasCharacteristic(const char* /*uuid*/) const { return false; }
+};
+
+/*!
+ * @brief Local BLE device without a radio.
+ */
+class BLELocalDevice {
+public:
+    int begin() { return 1; }
+    void end() { }
+    void poll() { }
+    void poll(unsigned long /*timeout*/) { }
+    bool connected() const { return false; }
+    bool disconnect() { return true; }
+    String address() const { return String(); }
+    int rssi() { return 0; }
+    int scan(bool /*withDuplicates*/ = false) { return 1; }
+    int scanForName(String /*name*/, bool /*withDuplicates*/ = false) { return 1; }
+    int scanForUuid(String /*uuid*/, bool /*withDuplicates*/ = false) { return 1; }
+    int scanForAddress(String /*address*/, bool /*withDuplicates*/ = false) { return 1; }
+    void stopScan() { }
+    BLEDevice central() { return BLEDevice(); }
+    BLEDevice available() { return BLEDevice(); }
+    void setEventHandler(BLEDeviceEvent /*event*/, BLEDeviceEventHandler /*eventHandler*/) { }
+    void setConnectionInterval(uint16_t /*minimumConnectionInterval*/, uint16_t /*maximumConnectionInterval*/) { }
+    void setTimeout(unsigned long /*timeout*/) { }
+};
+
+extern BLELocalDevice BLE;
+
+#endif
@@ -0,0 +1,98 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ *
+ * Host implementations of the Arduino and ArduinoBLE shims.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <strings.h>
+#include <Arduino.h>
+#include <ArduinoBLE.h>
+#include "utility/ATT.h"
+#include "utility/HCI.h"
+
+HostSerial Serial;
+BLELocalDevice BLE;
+ATTClass ATT;
+HCIClass HCI;
+
+static const std::chrono::steady_clock::time_point START = std::chrono::steady_clock::now();
+
+unsigned long micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - START).count();
+}
+unsigned long millis() {
+    return micros() / 1000;
+}
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+void yield() {
+}
+long random(long howbig) {
+    return howbig ? rand() % howbig : 0;
+}
+void pinMode(uint8_t /*pin*/, uint8_t /*mode*/) {
+}
+void digitalWrite(uint8_t /*pin*/, uint8_t /*value*/) {
+}
+int analogRead(uint8_t /*pin*/) {
+    return 0;
+}
+void analogReadResolution(int /*bits*/) {
+}
+
+bool String::equalsIgnoreCase(const String& other) const {
+    return 0 == strcasecmp(c_str(), other.c_str());
+}
+void String::toLowerCase() {
+    for (char& c : _text) {
+        c = tolower(c);
+    }
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        write(buffer[i]);
+    }
+    return size;
+}
+size_t Print::print(const char* text) {
+    return write((const uint8_t*)text, strlen(text));
+}
+size_t Print::print(const String& text) {
+    return print(text.c_str());
+}
+size_t Print::print(char c) {
+    return write((uint8_t)c);
+}
+size_t Print::print(int value, int base) {
+    return print((long)value, base);
+}
+size_t Print::print(unsigned int value, int base) {
+    return print((unsigned long)value, base);
+}
+size_t Print::print(long value, int base) {
+    char text[24];
+    snprintf(text, sizeof text, (HEX == base) ? "%lX" : "%ld", value);
+    return print(text);
+}
+size_t Print::print(unsigned long value, int base) {
+    char text[24];
+    snprintf(text, sizeof text, (HEX == base) ? "%lX" : "%lu", value);
+    return print(text);
+}
+size_t Print::print(double value, int digits) {
+    char text[32];
+    snprintf(text, sizeof text, "%.*f", digits, value);
+    return print(text);
+}
+size_t Print::println() {
+    return print("\n");
+}
+
+size_t HostSerial::write(uint8_t b) {
+    return (EOF == putchar(b)) ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ *
+ * ArduinoBLE's ATT layer, without any connections on a host.
+ */
+
+#ifndef _ATT_H_
+#define _ATT_H_
+
+#include <cstdint>
+
+class ATTClass {
+public:
+    uint16_t connectionHandle(uint8_t /*addressType*/, const uint8_t /*address*/[6]) const { return 0xFFFF; }
+};
+
+extern ATTClass ATT;
+
+#endif
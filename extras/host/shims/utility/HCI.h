@@ -0,0 +1,20 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ *
+ * ArduinoBLE's HCI layer, without a controller on a host.
+ */
+
+#ifndef _HCI_H_
+#define _HCI_H_
+
+#include <cstdint>
+
+class HCIClass {
+public:
+    int leConnUpdate(uint16_t /*handle*/, uint16_t /*minInterval*/, uint16_t /*maxInterval*/,
+            uint16_t /*latency*/, uint16_t /*supervisionTimeout*/) { return -1; }
+};
+
+extern HCIClass HCI;
+
+#endif
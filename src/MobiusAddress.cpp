@@ -0,0 +1,24 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include <Arduino.h>
+#include "MobiusAddress.h"
+
+/*!
+ * Write the text form ("aa:bb:cc:dd:ee:ff", null terminated) into the given 'text'.
+ */
+void MobiusAddress::format(char text[TEXT_SIZE]) const {
+    for (uint8_t i = 0; i < TEXT_SIZE - 1; i++) {
+        text[i] = charAt(i);
+    }
+    text[TEXT_SIZE - 1] = '\0';
+}
+/*!
+ * @return the text form ("aa:bb:cc:dd:ee:ff")
+ */
+String MobiusAddress::toString() const {
+    char text[TEXT_SIZE];
+    format(text);
+    return String(text);
+}
@@ -0,0 +1,125 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusAddress_h
+#define _MobiusAddress_h
+
+#include <cstdint>
+#include <string.h>
+
+class String;
+
+/*!
+ * @brief Packed Bluetooth device address.
+ *
+ * This utility class holds a device address in 6 bytes (least significant
+ * byte first, as sent over the air) instead of its 17 character text form
+ * ("aa:bb:cc:dd:ee:ff"). Addresses can be parsed and formatted at compile time:
+ *
+ *     constexpr MobiusAddress PUMP("aa:bb:cc:dd:ee:ff");
+ *
+ * An address which fails to parse is null (all zero).
+ */
+class MobiusAddress {
+public:
+    /*!
+     * Number of bytes of an address.
+     */
+    static const uint8_t SIZE = 6;
+    /*!
+     * Number of characters of the text form, including the terminating null.
+     */
+    static const uint8_t TEXT_SIZE = 18;
+
+    /*!
+     * Constructs a null address.
+     */
+    constexpr MobiusAddress() : _bytes{ 0, 0, 0, 0, 0, 0 } { }
+
+    /*!
+     * Constructs the address of the given 'text' ("aa:bb:cc:dd:ee:ff"),
+     * null if the text isn't a valid address.
+     */
+    constexpr explicit MobiusAddress(const char* text) : _bytes{
+        parseByte(text, 5), parseByte(text, 4), parseByte(text, 3),
+        parseByte(text, 2), parseByte(text, 1), parseByte(text, 0) } { }
+
+    /*!
+     * Constructs the address of the given 'bytes' (least significant first).
+     */
+    explicit MobiusAddress(const uint8_t* bytes) { memcpy(_bytes, bytes, SIZE); }
+
+    /*!
+     * @return true if the given 'text' is a valid address ("aa:bb:cc:dd:ee:ff")
+     */
+    static constexpr bool valid(const char* text) { return validFrom(text, 0); }
+
+    /*!
+     * @return the address bytes (least significant first)
+     */
+    const uint8_t* bytes() const { return _bytes; }
+
+    /*!
+     * @return the byte at the given 'index' (below SIZE, least significant first)
+     */
+    constexpr uint8_t operator[](uint8_t index) const { return _bytes[index]; }
+
+    /*!
+     * @return true if not null
+     */
+    constexpr explicit operator bool() const {
+        return _bytes[0] || _bytes[1] || _bytes[2] || _bytes[3] || _bytes[4] || _bytes[5];
+    }
+
+    bool operator==(const MobiusAddress& other) const { return 0 == memcmp(_bytes, other._bytes, SIZE); }
+    bool operator!=(const MobiusAddress& other) const { return !(*this == other); }
+
+    /*!
+     * @return the character at the given 'index' (below TEXT_SIZE - 1) of the text form
+     */
+    constexpr char charAt(uint8_t index) const {
+        return (2 == index % 3) ? ':' : hexDigit(index % 3 ? _bytes[5 - index / 3] & 0x0F : _bytes[5 - index / 3] >> 4);
+    }
+
+    /*!
+     * Write the text form ("aa:bb:cc:dd:ee:ff", null terminated) into the given 'text'.
+     */
+    void format(char text[TEXT_SIZE]) const;
+
+    /*!
+     * @return the text form ("aa:bb:cc:dd:ee:ff")
+     */
+    String toString() const;
+
+private:
+    uint8_t _bytes[SIZE];
+
+    static constexpr bool isHex(char c) {
+        return ('0' <= c && c <= '9') || ('a' <= c && c <= 'f') || ('A' <= c && c <= 'F');
+    }
+    static constexpr uint8_t hexValue(char c) {
+        return ('0' <= c && c <= '9') ? c - '0' : ('a' <= c && c <= 'f') ? c - 'a' + 10 : c - 'A' + 10;
+    }
+    static constexpr char hexDigit(uint8_t value) {
+        return (10 > value) ? '0' + value : 'a' + value - 10;
+    }
+    /*!
+     * @return true if the 'text' is valid from character 'index' on
+     * (stops at the first invalid character, so never reads past the end)
+     */
+    static constexpr bool validFrom(const char* text, uint8_t index) {
+        return (TEXT_SIZE - 1 == index) ||
+            (((2 == index % 3) ? ':' == text[index] : isHex(text[index])) && validFrom(text, index + 1));
+    }
+    /*!
+     * @return the value of the 'pair'th hex pair of the 'text' (0 if the text is invalid)
+     */
+    static constexpr uint8_t parseByte(const char* text, uint8_t pair) {
+        return valid(text) ? (hexValue(text[pair * 3]) << 4) | hexValue(text[pair * 3 + 1]) : 0;
+    }
+};
+
+static_assert(sizeof(MobiusAddress) == MobiusAddress::SIZE, "MobiusAddress must stay packed");
+
+#endif
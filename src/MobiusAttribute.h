@@ -0,0 +1,160 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusAttribute_h
+#define _MobiusAttribute_h
+
+#include <cstdint>
+#include "MobiusSpan.h"
+#include "MobiusFrame.h"
+#include "MobiusBatch.h"
+
+/*!
+ * @brief Mobius attribute descriptor.
+ *
+ * This template describes a single attribute of type 'T' with the given
+ * attribute 'ID', sent as a little endian value of 'VALUE_SIZE' bytes
+ * (padded with zeros beyond the size of 'T'). The record layout (see
+ * MobiusBatch) is derived at compile time, so each attribute gets its own
+ * encoder and decoder without record templates patched at magic offsets:
+ *
+ *     typedef MobiusAttribute<401, uint16_t, 4> CurrentScene;
+ *     CurrentScene::writeSet(writer, 42);
+ *
+ * The descriptors of the known attributes are defined in namespace Mobius.
+ * Types up to 4 bytes are supported (integers, enums and bool).
+ */
+template <uint16_t ID_, typename T, uint8_t VALUE_SIZE = sizeof(T)>
+class MobiusAttribute {
+public:
+    static_assert(sizeof(T) <= VALUE_SIZE, "value size too small for the type");
+    static_assert(sizeof(T) <= 4, "attribute types are limited to 4 bytes");
+
+    /*!
+     * Type of the attribute's value.
+     */
+    typedef T Type;
+    /*!
+     * Attribute ID.
+     */
+    static const uint16_t ID = ID_;
+    /*!
+     * Number of bytes of the value.
+     */
+    static const uint8_t SIZE = VALUE_SIZE;
+    /*!
+     * Number of bytes of the attribute's "get" request record.
+     */
+    static const uint8_t GET_SIZE = 4;
+    /*!
+     * Number of bytes of the attribute's "set" request (and "get" response) record.
+     */
+    static const uint8_t SET_SIZE = 5 + VALUE_SIZE;
+
+    /*!
+     * @brief Encode a value.
+     *
+     * Write the given 'value' into 'bytes' (of at least SIZE bytes).
+     */
+    static void encode(T value, uint8_t* bytes) {
+        uint32_t raw = (uint32_t)value;
+        for (uint8_t i = 0; i < SIZE; i++) {
+            // little endian, zero padded
+            bytes[i] = (i < sizeof(T)) ? (uint8_t)(raw >> (8 * i)) : 0x00;
+        }
+    }
+
+    /*!
+     * @brief Decode a value.
+     *
+     * @return the value in the given 'bytes' (of at least SIZE bytes)
+     */
+    static T decode(const uint8_t* bytes) {
+        uint32_t raw = 0;
+        for (uint8_t i = 0; i < sizeof(T); i++) {
+            raw |= (uint32_t)bytes[i] << (8 * i);
+        }
+        return (T)raw;
+    }
+
+    /*!
+     * @brief Write the "get" request record.
+     *
+     * Write the record requesting the attribute (GET_SIZE bytes) to the
+     * given 'writer'.
+     *
+     * @return true if the record fit the frame
+     */
+    static bool writeGet(MobiusFrameWriter& writer) {
+        uint8_t record[GET_SIZE];
+        header(record);
+        return writer.write(record, GET_SIZE);
+    }
+
+    /*!
+     * @brief Write the "set" request record.
+     *
+     * Write the record setting the attribute to the given 'value'
+     * (SET_SIZE bytes) to the given 'writer'.
+     *
+     * @return true if the record fit the frame
+     */
+    static bool writeSet(MobiusFrameWriter& writer, T value) {
+        uint8_t record[SET_SIZE];
+        header(record);
+        record[4] = SIZE;
+        encode(value, &record[5]);
+        return writer.write(record, SET_SIZE);
+    }
+
+    /*!
+     * @brief Add a "get" record to a batch.
+     *
+     * @return true if the record was added to the given 'batch'
+     */
+    static bool get(MobiusBatch& batch) {
+        return batch.get(ID);
+    }
+
+    /*!
+     * @brief Add a "set" record to a batch.
+     *
+     * @return true if the record setting the given 'value' was added to the given 'batch'
+     */
+    static bool set(MobiusBatch& batch, T value) {
+        uint8_t bytes[SIZE];
+        encode(value, bytes);
+        return batch.set(ID, bytes, SIZE);
+    }
+
+    /*!
+     * @brief Read the value from a "get" response.
+     *
+     * Find the attribute in the given response 'data' and decode its value
+     * into 'value'. A single attribute response is found without searching.
+     *
+     * @return true if the attribute's value was in the data
+     */
+    static bool read(MobiusSpan data, T& value) {
+        MobiusSpan bytes = MobiusBatch::value(data, ID);
+        if (SIZE > bytes.size()) {
+            return false;
+        }
+        value = decode(bytes.data());
+        return true;
+    }
+
+private:
+    /*!
+     * Write the record header (attribute ID, 0x00, 0x01) into 'record'.
+     */
+    static void header(uint8_t* record) {
+        record[0] = (uint8_t)ID;        // little endian
+        record[1] = (uint8_t)(ID >> 8); // little endian
+        record[2] = 0x00;
+        record[3] = 0x01;
+    }
+};
+
+#endif
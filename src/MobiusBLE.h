@@ -5,7 +5,17 @@
 #ifndef _MOBIUS_BLE_H_
 #define _MOBIUS_BLE_H_
 
+#include "MobiusAddress.h"
+#include "MobiusAttribute.h"
+#include "MobiusBatch.h"
 #include "MobiusCRC.h"
+#include "MobiusCache.h"
+#include "MobiusCapture.h"
 #include "MobiusDevice.h"
+#include "MobiusFleet.h"
+#include "MobiusQueue.h"
+#include "MobiusScanner.h"
+#include "MobiusSchedule.h"
+#include "MobiusTrace.h"
 
 #endif
@@ -0,0 +1,107 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include <Arduino.h>
+#include <string.h>
+#include "MobiusBatch.h"
+#include "MobiusDevice.h"
+
+/*!
+ * Constructs an empty batch.
+ */
+MobiusBatch::MobiusBatch() {
+    clear();
+}
+/*!
+ * @brief Remove all records.
+ */
+void MobiusBatch::clear() {
+    _size = 0;
+    _count = 0;
+    _opCode = 0;
+}
+/*!
+ * @brief Add a "get" record.
+ *
+ * Request the value of the attribute with the given 'attributeId'.
+ *
+ * @return true if the record was added
+ */
+bool MobiusBatch::get(uint16_t attributeId) {
+    return addHeader(Mobius::OP_CODE_GET, attributeId, 4);
+}
+/*!
+ * @brief Add a "set" record.
+ *
+ * Set the attribute with the given 'attributeId' to the given 'value'
+ * (of size 'length').
+ *
+ * @return true if the record was added
+ */
+bool MobiusBatch::set(uint16_t attributeId, const uint8_t* value, uint8_t length) {
+    if (!addHeader(Mobius::OP_CODE_SET, attributeId, 5 + length)) {
+        return false;
+    }
+    _data[_size++] = length;
+    memcpy(&_data[_size], value, length);
+    _size += length;
+    return true;
+}
+/*!
+ * @return the request op code of the batch (OP_CODE_GET or OP_CODE_SET), 0 if empty
+ */
+uint8_t MobiusBatch::opCode() const {
+    return _opCode;
+}
+/*!
+ * @return number of records in the batch
+ */
+uint8_t MobiusBatch::count() const {
+    return _count;
+}
+/*!
+ * @return a view of the records (the request's data section)
+ */
+MobiusSpan MobiusBatch::data() const {
+    return MobiusSpan(_data, _size);
+}
+/*!
+ * @brief Find an attribute's value in a "get" response.
+ *
+ * Searches the records in the given response 'data' for the attribute
+ * with the given 'attributeId'.
+ *
+ * @return a view of the value, empty if the attribute isn't in the data
+ */
+MobiusSpan MobiusBatch::value(MobiusSpan data, uint16_t attributeId) {
+    // skip the status byte, then walk the records
+    uint16_t offset = 1;
+    while (offset + 5 <= data.size()) {
+        uint16_t id = data[offset] | (data[offset + 1] << 8);
+        uint8_t length = data[offset + 4];
+        if (id == attributeId) {
+            return data.sub(offset + 5, length);
+        }
+        offset += 5 + length;
+    }
+    return MobiusSpan();
+}
+/*!
+ * Add a record header for the given 'attributeId' if 'length' more bytes
+ * fit and the batch is empty or of the given 'opCode'.
+ *
+ * @return true if the header was added
+ */
+bool MobiusBatch::addHeader(uint8_t opCode, uint16_t attributeId, uint16_t length) {
+    if ((_opCode && opCode != _opCode) || CAPACITY < _size + length) {
+        return false;
+    }
+    _opCode = opCode;
+    _count++;
+    _data[_size++] = lowByte(attributeId); // little endian
+    _data[_size++] = highByte(attributeId);// little endian
+    _data[_size++] = 0x00;
+    _data[_size++] = 0x01;
+    return true;
+}
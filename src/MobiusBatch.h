@@ -0,0 +1,108 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusBatch_h
+#define _MobiusBatch_h
+
+#include <cstdint>
+#include "MobiusSpan.h"
+
+#ifndef MOBIUS_MAX_REQUEST_SIZE
+/*!
+ * Size of the request frame buffer shared by all MobiusDevices.
+ */
+#define MOBIUS_MAX_REQUEST_SIZE 64
+#endif
+
+/*!
+ * @brief Mobius class for batching attribute records.
+ *
+ * This class packs several attribute records into the data section of a
+ * single "get" or "set" request, so multiple attributes are read or written
+ * with one round trip. A batch holds either "get" or "set" records, not both.
+ *
+ * Attribute records are laid out as:
+ * - "get" request: attribute ID (little endian), 0x00, 0x01
+ * - "set" request and "get" response: attribute ID (little endian), 0x00, 0x01,
+ *   value size, value
+ * A "get" response's data starts with a 0x00 status byte followed by one
+ * record per requested attribute.
+ */
+class MobiusBatch {
+public:
+    /*!
+     * Maximum number of bytes of records fitting a single request frame.
+     */
+    static const uint16_t CAPACITY = MOBIUS_MAX_REQUEST_SIZE - 11;
+
+    /*!
+     * Constructs an empty batch.
+     */
+    MobiusBatch();
+
+    /*!
+     * @brief Remove all records.
+     */
+    void clear();
+
+    /*!
+     * @brief Add a "get" record.
+     *
+     * Request the value of the attribute with the given 'attributeId'.
+     *
+     * @return true if the record was added
+     */
+    bool get(uint16_t attributeId);
+
+    /*!
+     * @brief Add a "set" record.
+     *
+     * Set the attribute with the given 'attributeId' to the given 'value'
+     * (of size 'length').
+     *
+     * @return true if the record was added
+     */
+    bool set(uint16_t attributeId, const uint8_t* value, uint8_t length);
+
+    /*!
+     * @return the request op code of the batch (OP_CODE_GET or OP_CODE_SET), 0 if empty
+     */
+    uint8_t opCode() const;
+
+    /*!
+     * @return number of records in the batch
+     */
+    uint8_t count() const;
+
+    /*!
+     * @return a view of the records (the request's data section)
+     */
+    MobiusSpan data() const;
+
+    /*!
+     * @brief Find an attribute's value in a "get" response.
+     *
+     * Searches the records in the given response 'data' for the attribute
+     * with the given 'attributeId'.
+     *
+     * @return a view of the value, empty if the attribute isn't in the data
+     */
+    static MobiusSpan value(MobiusSpan data, uint16_t attributeId);
+
+private:
+    uint8_t _data[CAPACITY];
+    uint16_t _size;
+    uint8_t _count;
+    uint8_t _opCode;
+
+    /*!
+     * Add a record header for the given 'attributeId' if 'length' more bytes
+     * fit and the batch is empty or of the given 'opCode'.
+     *
+     * @return true if the header was added
+     */
+    bool addHeader(uint8_t opCode, uint16_t attributeId, uint16_t length);
+};
+
+#endif
@@ -1,21 +1,139 @@
-/*!
- * This file is part of the MobiusBLE library.
- */
-
-#include "MobiusCRC.h"
-
-/*!
- * @brief Generates a 16 bit CRC.
- *
- * @param data bytes for generating the check
- * @param length size the byte array
- * @return 16 bit CRC value
- */
-uint16_t MobiusCRC::crc16(uint8_t* data, int length) {
-    uint16_t crc16 = -1;
-    for (int i = 0; i < length; i++) {
-        uint8_t dex = (data[i] ^ ((uint8_t)(crc16 >> 8))) & 0xff;
-        crc16 = (uint16_t)((crc16 << 8) ^ Mobius::CRC16_TABLE[dex]);
-    }
-    return crc16;
-}
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include "MobiusCRC.h"
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#define MOBIUS_CRC_PROGMEM PROGMEM
+#define MOBIUS_CRC_READ(entry) pgm_read_word(&(entry))
+#else
+#define MOBIUS_CRC_PROGMEM
+#define MOBIUS_CRC_READ(entry) (entry)
+#endif
+
+namespace {
+    /*!
+     * Shifts the given 'crc' by 'bits' zero bits.
+     */
+    constexpr uint16_t crcShift(uint16_t crc, uint8_t bits) {
+        return bits ? crcShift((crc & 0x8000) ? (uint16_t)((crc << 1) ^ Mobius::CRC16_POLYNOMIAL) : (uint16_t)(crc << 1), bits - 1) : crc;
+    }
+}
+
+// expand f(0) ... f(255) as an array initializer
+#define MOBIUS_CRC_4(f, i) f(i), f(i + 1), f(i + 2), f(i + 3)
+#define MOBIUS_CRC_16(f, i) MOBIUS_CRC_4(f, i), MOBIUS_CRC_4(f, i + 4), MOBIUS_CRC_4(f, i + 8), MOBIUS_CRC_4(f, i + 12)
+#define MOBIUS_CRC_64(f, i) MOBIUS_CRC_16(f, i), MOBIUS_CRC_16(f, i + 16), MOBIUS_CRC_16(f, i + 32), MOBIUS_CRC_16(f, i + 48)
+#define MOBIUS_CRC_256(f) { MOBIUS_CRC_64(f, 0), MOBIUS_CRC_64(f, 64), MOBIUS_CRC_64(f, 128), MOBIUS_CRC_64(f, 192) }
+// CRC of the byte 'i' followed by 'zeros' zero bytes
+#define MOBIUS_CRC_SLICE(i, zeros) crcShift((uint16_t)((i) << 8), 8 * (1 + zeros))
+#define MOBIUS_CRC_SLICE_0(i) MOBIUS_CRC_SLICE(i, 0)
+#define MOBIUS_CRC_SLICE_1(i) MOBIUS_CRC_SLICE(i, 1)
+#define MOBIUS_CRC_SLICE_2(i) MOBIUS_CRC_SLICE(i, 2)
+#define MOBIUS_CRC_SLICE_3(i) MOBIUS_CRC_SLICE(i, 3)
+
+#if MOBIUS_CRC_STRATEGY != MOBIUS_CRC_BITWISE
+/*!
+ * Array of 256 unsigned short values, the CRC of each single byte.
+ * Generated at compile time and placed in PROGMEM on AVR, so it is
+ * only read through MOBIUS_CRC_READ().
+ */
+static constexpr uint16_t CRC16_TABLE[256] MOBIUS_CRC_PROGMEM = MOBIUS_CRC_256(MOBIUS_CRC_SLICE_0);
+
+// same values as the table copied from the Mobius android app
+static_assert(CRC16_TABLE[1] == 4129 && CRC16_TABLE[8] == (uint16_t)-32504
+    && CRC16_TABLE[255] == 7920, "CRC16_TABLE doesn't match the Mobius app");
+#endif
+
+#if MOBIUS_CRC_STRATEGY == MOBIUS_CRC_SLICING_BY_4
+/*!
+ * CRC of each single byte followed by 1, 2 and 3 zero bytes.
+ */
+static constexpr uint16_t CRC16_SLICES[3][256] MOBIUS_CRC_PROGMEM = {
+    MOBIUS_CRC_256(MOBIUS_CRC_SLICE_1),
+    MOBIUS_CRC_256(MOBIUS_CRC_SLICE_2),
+    MOBIUS_CRC_256(MOBIUS_CRC_SLICE_3)
+};
+#endif
+
+/*!
+ * Constructs a check of no bytes yet.
+ */
+MobiusCRC::MobiusCRC() {
+    init();
+}
+/*!
+ * @brief Start a new check.
+ *
+ * Discards the bytes checked so far.
+ */
+void MobiusCRC::init() {
+    _crc = 0xFFFF;
+}
+/*!
+ * @brief Continue the check over more bytes.
+ *
+ * @param data bytes for continuing the check
+ * @param length size the byte array
+ */
+void MobiusCRC::update(const uint8_t* data, int length) {
+    _crc = crc16(_crc, data, length);
+}
+/*!
+ * @return 16 bit CRC value of all bytes passed to update() since init()
+ */
+uint16_t MobiusCRC::final() const {
+    return _crc;
+}
+/*!
+ * @brief Generates a 16 bit CRC.
+ *
+ * @param data bytes for generating the check
+ * @param length size the byte array
+ * @return 16 bit CRC value
+ */
+uint16_t MobiusCRC::crc16(const uint8_t* data, int length) {
+    return crc16(0xFFFF, data, length);
+}
+/*!
+ * @brief Continues a 16 bit CRC.
+ *
+ * Continues the given 'crc' of the preceding bytes over more bytes,
+ * allowing data received in pieces to be checked as it arrives.
+ * The initial 'crc' (before any bytes) is 0xFFFF.
+ *
+ * @param crc check value of the preceding bytes
+ * @param data bytes for continuing the check
+ * @param length size the byte array
+ * @return 16 bit CRC value
+ */
+uint16_t MobiusCRC::crc16(uint16_t crc, const uint8_t* data, int length) {
+    uint16_t crc16 = crc;
+#if MOBIUS_CRC_STRATEGY == MOBIUS_CRC_BITWISE
+    for (int i = 0; i < length; i++) {
+        crc16 ^= (uint16_t)(data[i] << 8);
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc16 = (crc16 & 0x8000) ? (uint16_t)((crc16 << 1) ^ Mobius::CRC16_POLYNOMIAL) : (uint16_t)(crc16 << 1);
+        }
+    }
+#else
+    int i = 0;
+#if MOBIUS_CRC_STRATEGY == MOBIUS_CRC_SLICING_BY_4
+    // fold 4 bytes at a time, the first 2 overlap the current CRC
+    for (; i + 4 <= length; i += 4) {
+        uint16_t top = crc16 ^ (uint16_t)((data[i] << 8) | data[i + 1]);
+        crc16 = MOBIUS_CRC_READ(CRC16_SLICES[2][top >> 8])
+            ^ MOBIUS_CRC_READ(CRC16_SLICES[1][top & 0xff])
+            ^ MOBIUS_CRC_READ(CRC16_SLICES[0][data[i + 2]])
+            ^ MOBIUS_CRC_READ(CRC16_TABLE[data[i + 3]]);
+    }
+#endif
+    for (; i < length; i++) {
+        uint8_t dex = (data[i] ^ ((uint8_t)(crc16 >> 8))) & 0xff;
+        crc16 = (uint16_t)((crc16 << 8) ^ MOBIUS_CRC_READ(CRC16_TABLE[dex]));
+    }
+#endif
+    return crc16;
+}
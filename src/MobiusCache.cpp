@@ -0,0 +1,201 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include <Arduino.h>
+#include <string.h>
+#include "MobiusCache.h"
+#include "MobiusCRC.h"
+
+/*!
+ * Cached devices, ordered from the least to the most recently stored.
+ */
+MobiusCache::Entry MobiusCache::_entries[MOBIUS_CACHE_SIZE] = { };
+uint8_t MobiusCache::_count = 0;
+MobiusCache::StorageWriter MobiusCache::_writer = nullptr;
+bool MobiusCache::_dirty = false;
+unsigned long MobiusCache::_changedMillis = 0;
+/*!
+ * Unsigned long of the milliseconds without scene changes before changed
+ * scenes are persisted, so a sketch cycling scenes doesn't wear out the
+ * storage.
+ * Defaults to 60000
+ */
+unsigned long MobiusCache::sceneSaveDelay = 60000;
+
+/*!
+ * @brief Set the cache storage.
+ *
+ * Load the cache with the given 'reader' and persist any future
+ * changes with the given 'writer'. Either may be null.
+ *
+ * @return true if a valid cache was loaded
+ */
+bool MobiusCache::setStorage(StorageReader reader, StorageWriter writer) {
+    _writer = writer;
+    bool loaded = false;
+    uint8_t data[STORAGE_SIZE];
+    if (reader && reader(data, STORAGE_SIZE)) {
+        // check the header, count and CRC before trusting the data
+        uint16_t crc = MobiusCRC::crc16(data, STORAGE_SIZE - 2);
+        loaded = ('M' == data[0]) && ('C' == data[1]) && (MOBIUS_CACHE_SIZE >= data[2]);
+        loaded = loaded && (data[STORAGE_SIZE - 2] == (uint8_t)crc) && (data[STORAGE_SIZE - 1] == (uint8_t)(crc >> 8));
+    }
+    if (loaded) {
+        _count = data[2];
+        memcpy(_entries, &data[3], sizeof _entries);
+    }
+    return loaded;
+}
+/*!
+ * Find the entry of the device with the given 'address'.
+ *
+ * @return a pointer to the entry, or null if the device is unknown
+ */
+const MobiusCache::Entry* MobiusCache::find(const MobiusAddress& address) {
+    int8_t index = address ? indexOf(address) : -1;
+    return (0 <= index) ? &_entries[index] : nullptr;
+}
+/*!
+ * Find the entry of the device with the given 'address' ("aa:bb:cc:dd:ee:ff").
+ *
+ * @return a pointer to the entry, or null if the device is unknown
+ */
+const MobiusCache::Entry* MobiusCache::find(const char* address) {
+    return find(MobiusAddress(address));
+}
+/*!
+ * Add or update the entry of the device with the given 'address',
+ * making it the most recent one. The oldest entry is replaced when
+ * the cache is full.
+ */
+void MobiusCache::store(const MobiusAddress& address, uint8_t requestIndex, uint8_t rxDataIndex, uint8_t rxFinalIndex) {
+    if (!address) {
+        return;
+    }
+    // value initialized to clear the padding, entries are compared and persisted as bytes
+    Entry entry = Entry();
+    entry.address = address;
+    entry.requestIndex = requestIndex;
+    entry.rxDataIndex = rxDataIndex;
+    entry.rxFinalIndex = rxFinalIndex;
+
+    int8_t index = indexOf(entry.address);
+    // finding the characteristics again leaves the scene unchanged
+    entry.sceneId = (0 <= index) ? _entries[index].sceneId : UNKNOWN_SCENE;
+    // nothing changed besides the order, avoid wearing the storage
+    bool changed = (0 > index) || 0 != memcmp(&_entries[index], &entry, sizeof entry);
+    if (0 > index && MOBIUS_CACHE_SIZE > _count) {
+        // append the new device
+        index = _count++;
+    }
+    else if (0 > index) {
+        // full, replace the oldest device
+        index = 0;
+    }
+    // move the entry to the end (most recent)
+    memmove(&_entries[index], &_entries[index + 1], (_count - index - 1) * sizeof(Entry));
+    _entries[_count - 1] = entry;
+    if (changed) {
+        save();
+    }
+}
+/*!
+ * Update the last scene of the known device with the given 'address'
+ * to 'sceneId'. Unknown devices are ignored. A changed scene is only
+ * persisted once no scene changed for 'sceneSaveDelay' (see poll()),
+ * on flush(), or along with the next change of the devices.
+ */
+void MobiusCache::storeScene(const MobiusAddress& address, uint16_t sceneId) {
+    int8_t index = address ? indexOf(address) : -1;
+    if (0 <= index && sceneId != _entries[index].sceneId) {
+        _entries[index].sceneId = sceneId;
+        _dirty = true;
+        _changedMillis = millis();
+    }
+}
+/*!
+ * Persist the cache after 'sceneSaveDelay' without scene changes.
+ * Called by MobiusDevice::poll().
+ */
+void MobiusCache::poll() {
+    if (_dirty && sceneSaveDelay <= (millis() - _changedMillis)) {
+        save();
+    }
+}
+/*!
+ * Persist changed scenes now. Called when a device disconnects.
+ */
+void MobiusCache::flush() {
+    if (_dirty) {
+        save();
+    }
+}
+/*!
+ * Remove the entry of the device with the given 'address'.
+ */
+void MobiusCache::forget(const MobiusAddress& address) {
+    int8_t index = address ? indexOf(address) : -1;
+    if (0 <= index) {
+        memmove(&_entries[index], &_entries[index + 1], (_count - index - 1) * sizeof(Entry));
+        _count--;
+        save();
+    }
+}
+/*!
+ * Remove the entry of the device with the given 'address' ("aa:bb:cc:dd:ee:ff").
+ */
+void MobiusCache::forget(const char* address) {
+    forget(MobiusAddress(address));
+}
+/*!
+ * Remove all entries.
+ */
+void MobiusCache::clear() {
+    _count = 0;
+    for (uint8_t i = 0; i < MOBIUS_CACHE_SIZE; i++) {
+        _entries[i] = Entry();
+    }
+    save();
+}
+/*!
+ * @return the entry at the given 'index' (below count(), the most recently stored last), or null
+ */
+const MobiusCache::Entry* MobiusCache::entry(uint8_t index) {
+    return (index < _count) ? &_entries[index] : nullptr;
+}
+/*!
+ * @return number of cached devices
+ */
+uint8_t MobiusCache::count() {
+    return _count;
+}
+/*!
+ * @return index of the entry with the given 'address', or -1 if unknown
+ */
+int8_t MobiusCache::indexOf(const MobiusAddress& address) {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_entries[i].address == address) {
+            return i;
+        }
+    }
+    return -1;
+}
+/*!
+ * Persist the cache with the storage writer (if any).
+ */
+void MobiusCache::save() {
+    _dirty = false;
+    if (!_writer) {
+        return;
+    }
+    uint8_t data[STORAGE_SIZE];
+    data[0] = 'M';
+    data[1] = 'C';
+    data[2] = _count;
+    memcpy(&data[3], _entries, sizeof _entries);
+    uint16_t crc = MobiusCRC::crc16(data, STORAGE_SIZE - 2);
+    data[STORAGE_SIZE - 2] = (uint8_t)crc;
+    data[STORAGE_SIZE - 1] = (uint8_t)(crc >> 8);
+    _writer(data, STORAGE_SIZE);
+}
@@ -0,0 +1,166 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusCache_h
+#define _MobiusCache_h
+
+#include <cstdint>
+#include "MobiusAddress.h"
+
+#ifndef MOBIUS_CACHE_SIZE
+/*!
+ * Maximum number of devices kept in the MobiusCache.
+ */
+#define MOBIUS_CACHE_SIZE 8
+#endif
+
+/*!
+ * @brief Cache of previously discovered Mobius devices.
+ *
+ * This utility class remembers where the Mobius characteristics were found on
+ * each connected device (keyed by device address), so reconnecting to a known
+ * device resolves and subscribes to them directly instead of searching by UUID.
+ * The last scene reported by each device is kept along with them. The cache may
+ * be persisted by supplying storage functions (e.g. EEPROM or flash), so the
+ * known devices can be used straight after a reset without scanning for them.
+ */
+class MobiusCache {
+public:
+    /*!
+     * @brief Cached details of a single device.
+     */
+    struct Entry {
+        MobiusAddress address;
+        uint8_t requestIndex;
+        uint8_t rxDataIndex;
+        uint8_t rxFinalIndex;
+        // last scene set or reported, 0xFFFF if unknown
+        uint16_t sceneId;
+    };
+
+    /*!
+     * Function reading 'size' bytes of persisted cache into 'data'.
+     *
+     * @return true if the data was read
+     */
+    typedef bool (*StorageReader)(uint8_t* data, uint16_t size);
+    /*!
+     * Function persisting 'size' bytes of cache from 'data'.
+     *
+     * @return true if the data was written
+     */
+    typedef bool (*StorageWriter)(const uint8_t* data, uint16_t size);
+
+    /*!
+     * Number of bytes needed to persist the cache.
+     */
+    static const uint16_t STORAGE_SIZE = 3 + MOBIUS_CACHE_SIZE * sizeof(Entry) + 2;
+
+    /*!
+     * Scene ID of entries whose scene is unknown.
+     */
+    static const uint16_t UNKNOWN_SCENE = 0xFFFF;
+
+    /*!
+     * Unsigned long of the milliseconds without scene changes before changed
+     * scenes are persisted, so a sketch cycling scenes doesn't wear out the
+     * storage.
+     */
+    static unsigned long sceneSaveDelay;
+
+    /*!
+     * @brief Set the cache storage.
+     *
+     * Load the cache with the given 'reader' and persist any future
+     * changes with the given 'writer'. Either may be null.
+     *
+     * @return true if a valid cache was loaded
+     */
+    static bool setStorage(StorageReader reader, StorageWriter writer);
+
+    /*!
+     * Find the entry of the device with the given 'address'.
+     *
+     * @return a pointer to the entry, or null if the device is unknown
+     */
+    static const Entry* find(const MobiusAddress& address);
+
+    /*!
+     * Find the entry of the device with the given 'address' ("aa:bb:cc:dd:ee:ff").
+     *
+     * @return a pointer to the entry, or null if the device is unknown
+     */
+    static const Entry* find(const char* address);
+
+    /*!
+     * Add or update the entry of the device with the given 'address',
+     * making it the most recent one. The oldest entry is replaced when
+     * the cache is full.
+     */
+    static void store(const MobiusAddress& address, uint8_t requestIndex, uint8_t rxDataIndex, uint8_t rxFinalIndex);
+
+    /*!
+     * Update the last scene of the known device with the given 'address'
+     * to 'sceneId'. Unknown devices are ignored. A changed scene is only
+     * persisted once no scene changed for 'sceneSaveDelay' (see poll()),
+     * on flush(), or along with the next change of the devices.
+     */
+    static void storeScene(const MobiusAddress& address, uint16_t sceneId);
+
+    /*!
+     * Persist the cache after 'sceneSaveDelay' without scene changes.
+     * Called by MobiusDevice::poll().
+     */
+    static void poll();
+
+    /*!
+     * Persist changed scenes now. Called when a device disconnects.
+     */
+    static void flush();
+
+    /*!
+     * Remove the entry of the device with the given 'address'.
+     */
+    static void forget(const MobiusAddress& address);
+
+    /*!
+     * Remove the entry of the device with the given 'address' ("aa:bb:cc:dd:ee:ff").
+     */
+    static void forget(const char* address);
+
+    /*!
+     * Remove all entries.
+     */
+    static void clear();
+
+    /*!
+     * @return the entry at the given 'index' (below count(), the most recently stored last), or null
+     */
+    static const Entry* entry(uint8_t index);
+
+    /*!
+     * @return number of cached devices
+     */
+    static uint8_t count();
+
+private:
+    static Entry _entries[MOBIUS_CACHE_SIZE];
+    static uint8_t _count;
+    static StorageWriter _writer;
+    // scenes changed since the cache was persisted, and when they last changed
+    static bool _dirty;
+    static unsigned long _changedMillis;
+
+    /*!
+     * @return index of the entry with the given 'address', or -1 if unknown
+     */
+    static int8_t indexOf(const MobiusAddress& address);
+
+    /*!
+     * Persist the cache with the storage writer (if any).
+     */
+    static void save();
+};
+
+#endif
@@ -0,0 +1,125 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include <Arduino.h>
+#include "MobiusCapture.h"
+
+uint8_t* MobiusCapture::_buffer = nullptr;
+uint16_t MobiusCapture::_capacity = 0;
+uint16_t MobiusCapture::_start = 0;
+uint16_t MobiusCapture::_size = 0;
+uint32_t MobiusCapture::_dropped = 0;
+MobiusAddress MobiusCapture::_address;
+
+/*!
+ * @brief Start capturing.
+ *
+ * Record into the given 'buffer' (of size 'capacity'), which must stay
+ * valid while capturing. Only the frames of the device with the given
+ * 'address' are captured, all devices' frames if it is null.
+ */
+void MobiusCapture::begin(uint8_t* buffer, uint16_t capacity, const MobiusAddress& address) {
+    _buffer = buffer;
+    _capacity = buffer ? capacity : 0;
+    _address = address;
+    clear();
+}
+/*!
+ * Stop capturing, the buffer is no longer used.
+ */
+void MobiusCapture::end() {
+    begin(nullptr, 0);
+}
+/*!
+ * @return true if capturing
+ */
+bool MobiusCapture::capturing() {
+    return _buffer;
+}
+/*!
+ * Drop all records.
+ */
+void MobiusCapture::clear() {
+    _start = 0;
+    _size = 0;
+    _dropped = 0;
+}
+/*!
+ * @return number of bytes of records captured
+ */
+uint16_t MobiusCapture::size() {
+    return _size;
+}
+/*!
+ * @return number of records dropped to make room since the capture began
+ */
+uint32_t MobiusCapture::dropped() {
+    return _dropped;
+}
+/*!
+ * @brief Copy the capture.
+ *
+ * Copy the records, oldest first, into 'bytes' (of size 'length'),
+ * e.g. to persist them or send them to a host for replaying.
+ *
+ * @return number of bytes copied, only whole records are copied
+ */
+uint16_t MobiusCapture::copy(uint8_t* bytes, uint16_t length) {
+    uint16_t copied = 0;
+    while (copied < _size) {
+        uint16_t recordSize = RECORD_HEADER_SIZE + (at(copied + 5) | (at(copied + 6) << 8));
+        if (length < copied + recordSize) {
+            break;
+        }
+        for (uint16_t i = 0; i < recordSize; i++) {
+            bytes[copied + i] = at(copied + i);
+        }
+        copied += recordSize;
+    }
+    return copied;
+}
+/*!
+ * Record the given 'bytes' of the given 'type' exchanged with the
+ * device with the given 'address'. Called by MobiusDevice.
+ */
+void MobiusCapture::record(const MobiusAddress& address, Type type, MobiusSpan bytes) {
+    if (!_buffer || (_address && _address != address)) {
+        return;
+    }
+    uint32_t recordSize = RECORD_HEADER_SIZE + bytes.size();
+    if (_capacity < recordSize) {
+        // would never fit
+        _dropped++;
+        return;
+    }
+    // drop the oldest records to make room
+    while (_capacity < _size + recordSize) {
+        uint16_t oldestSize = RECORD_HEADER_SIZE + (at(5) | (at(6) << 8));
+        _start = (_start + oldestSize) % _capacity;
+        _size -= oldestSize;
+        _dropped++;
+    }
+    uint32_t now = micros();
+    uint8_t header[RECORD_HEADER_SIZE] = {
+        type,
+        (uint8_t)now, (uint8_t)(now >> 8), (uint8_t)(now >> 16), (uint8_t)(now >> 24), // little endian
+        lowByte(bytes.size()), highByte(bytes.size())                                     // little endian
+    };
+    append(header, RECORD_HEADER_SIZE);
+    append(bytes.data(), bytes.size());
+}
+/*!
+ * Write the given 'bytes' (of size 'length') at the end of the records.
+ */
+void MobiusCapture::append(const uint8_t* bytes, uint16_t length) {
+    for (uint16_t i = 0; i < length; i++) {
+        _buffer[((uint32_t)_start + _size++) % _capacity] = bytes[i];
+    }
+}
+/*!
+ * @return the byte at the given 'offset' from the oldest record
+ */
+uint8_t MobiusCapture::at(uint16_t offset) {
+    return _buffer[((uint32_t)_start + offset) % _capacity];
+}
@@ -0,0 +1,109 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusCapture_h
+#define _MobiusCapture_h
+
+#include <cstdint>
+#include "MobiusSpan.h"
+#include "MobiusAddress.h"
+
+/*!
+ * @brief Capture of the frames exchanged with Mobius devices.
+ *
+ * This utility class records every request written and every response
+ * fragment received, with timestamps, into a caller provided ring buffer
+ * so field sessions can be replayed (see MobiusReplay) and profiled. Each
+ * record is encoded as: type, micros (4 bytes, little endian), length
+ * (2 bytes, little endian), bytes. When the buffer is full the oldest
+ * records are dropped. Without a buffer capturing costs a single check.
+ */
+class MobiusCapture {
+public:
+    /*!
+     * Types of captured records.
+     */
+    enum Type : uint8_t {
+        TYPE_CONNECT,   // device connected, the bytes are its address
+        TYPE_REQUEST,   // request frame written
+        TYPE_DATA,      // RX_DATA fragment received
+        TYPE_FINAL      // RX_FINAL fragment received, completing a response
+    };
+
+    /*!
+     * Number of bytes of a record besides its bytes.
+     */
+    static const uint8_t RECORD_HEADER_SIZE = 7;
+
+    /*!
+     * @brief Start capturing.
+     *
+     * Record into the given 'buffer' (of size 'capacity'), which must stay
+     * valid while capturing. Only the frames of the device with the given
+     * 'address' are captured, all devices' frames if it is null.
+     */
+    static void begin(uint8_t* buffer, uint16_t capacity, const MobiusAddress& address = MobiusAddress());
+
+    /*!
+     * Stop capturing, the buffer is no longer used.
+     */
+    static void end();
+
+    /*!
+     * @return true if capturing
+     */
+    static bool capturing();
+
+    /*!
+     * Drop all records.
+     */
+    static void clear();
+
+    /*!
+     * @return number of bytes of records captured
+     */
+    static uint16_t size();
+
+    /*!
+     * @return number of records dropped to make room since the capture began
+     */
+    static uint32_t dropped();
+
+    /*!
+     * @brief Copy the capture.
+     *
+     * Copy the records, oldest first, into 'bytes' (of size 'length'),
+     * e.g. to persist them or send them to a host for replaying.
+     *
+     * @return number of bytes copied, only whole records are copied
+     */
+    static uint16_t copy(uint8_t* bytes, uint16_t length);
+
+    /*!
+     * Record the given 'bytes' of the given 'type' exchanged with the
+     * device with the given 'address'. Called by MobiusDevice.
+     */
+    static void record(const MobiusAddress& address, Type type, MobiusSpan bytes);
+
+private:
+    static uint8_t* _buffer;
+    static uint16_t _capacity;
+    // offset of the oldest record and number of bytes used
+    static uint16_t _start;
+    static uint16_t _size;
+    static uint32_t _dropped;
+    static MobiusAddress _address;
+
+    /*!
+     * Write the given 'bytes' (of size 'length') at the end of the records.
+     */
+    static void append(const uint8_t* bytes, uint16_t length);
+
+    /*!
+     * @return the byte at the given 'offset' from the oldest record
+     */
+    static uint8_t at(uint16_t offset);
+};
+
+#endif
@@ -1,606 +1,1876 @@
-/*!
- * This file is part of the MobiusBLE library.
- */
-
-#include "MobiusDevice.h"
-#include "MobiusCRC.h"
-
-
-/*!
- * Unsigned integer of the PIN number for the red LED.
- */
-uint16_t MobiusDevice::redLed = 0;
-/*!
- * Unsigned integer of the PIN number for the blue LED.
- */
-uint16_t MobiusDevice::blueLed = 0;
-/*!
- * Unsigned integer of the PIN number for the green LED.
- */
-uint16_t MobiusDevice::greenLed = 0;
-/*!
- * Unsigned integer of the value to turn ON a LED.
- * Defaults to "LOW"
- */
-uint16_t MobiusDevice::ledOn = LOW;
-/*!
- * Unsigned integer of the value to turn OFF a LED.
- * Defaults to "HIGH"
- */
-uint16_t MobiusDevice::ledOff = HIGH;
-/*!
- * Boolean determining whether to log debug statements to "Serial".
- */
-bool MobiusDevice::debug = false;
-
-/*!
- * @brief Scan for BLEDevices
- *
- * Performs a scan for nearby BLEDevices which have a name of "MOBIUS".
- * Any found devices will have their corresponding addresses added to the
- * give 'addressBuffer'.
- *
- * @return number of found devices (number of addresses added)
- */
-uint8_t MobiusDevice::scanForMobiusDevices(String addressBuffer[]) {
-    uint8_t count = 0;
-    Serial.print("Scanning for BLE devices");
-    if (BLE.begin() && BLE.scanForName("MOBIUS", true)) {
-        BLEDevice device;
-        uint16_t purple[] = { redLed, blueLed };
-        for (uint8_t i = 0; !count && i < 3; i++) {
-            blinkLEDs(2, purple);
-            Serial.print('.');
-            device = BLE.available();
-            while (device) {
-                // add the new address
-                addressBuffer[count++] = device.address();
-                if (debug) {
-                    Serial.print(" Found ");
-                    Serial.print(device.address());
-                    Serial.print('\t');
-                }
-                blinkLEDs(1, purple);
-                // check for next device?
-                device = BLE.available();
-            }
-        }
-        Serial.println();
-        
-        if (debug) {
-            Serial.print("Device count:");
-            Serial.println(count);
-        }
-    } else {
-        Serial.println(" - Failed to start scan");
-    }
-    BLE.stopScan();
-    return count;
-}
-
-
-/*!
- * Default constructor.
- */
-MobiusDevice::MobiusDevice() { }
-
-/*!
- * Constructs a new MobiusDevice which has the given address.
- */
-MobiusDevice::MobiusDevice(String address) {
-    _address = address;
-}
-/*!
- * De-construct the class.
- */
-MobiusDevice::~MobiusDevice() {
-    disconnect();
-}
-/*!
- * @brief Connect to the device.
- *
- * Connect to the device corresponding to the current address and
- * verify it has the required BLE characteristics.
- *
- * @return true only if successfully connected
- */
-bool MobiusDevice::connect() {
-    // rest the message count/ID
-    // starting with 2, because why not?
-    _messageId = 2;
-    return connectTo(_address);
-}
-/*!
- * @brief Disconnect from the device.
- *
- * Disconnect from the currently connected device.
- *
- * @return true if no longer connected
- */
-bool MobiusDevice::disconnect() {
-    bool disconnected = true;
-    if (_device) {
-        disconnected = _device.disconnect();
-        // reset current BLE objects
-        _device = BLEDevice();
-        _requestChar = BLECharacteristic();
-        _responseChar = BLECharacteristic();
-    }
-    BLE.disconnect();
-    return disconnected;
-}
-/*!
- * @brief Get the currently running scene.
- *
- * Query the device to determine the currently running scene.
- *
- * @return an unsigned short
- */
-uint16_t MobiusDevice::getCurrentScene() {
-    uint16_t scene = -1;
-    uint16_t bodySize;
-    uint16_t attSize = sizeof Mobius::ATTRIBUTE_CURRENT_SCENE;
-    uint8_t attributes[attSize];
-    memcpy(attributes, Mobius::ATTRIBUTE_CURRENT_SCENE, attSize);
-
-    uint8_t* body = getData(attributes, attSize, bodySize);
-    scene = body[7];
-    scene = (scene << 8) + (body[6]);
-    delete[] body;
-    return scene;
-}
-/*!
- * @brief Set a new scene.
- *
- * Sends a set scene request with the given 'sceneId' and verify
- * the response indicates a successful set action.
- *
- * @return true if the 'set' was successful
- */
-bool MobiusDevice::setScene(uint16_t sceneId) {
-    uint16_t attSize = sizeof Mobius::ATTRIBUTE_SCENE;
-    uint8_t attributes[attSize];
-    memcpy(attributes, Mobius::ATTRIBUTE_SCENE, attSize);
-    // update scene ID portion of the attribute
-    attributes[5] = lowByte(sceneId); // little endian
-    attributes[6] = highByte(sceneId);// little endian
-
-    return setData(attributes, attSize);
-}
-/*!
- * @brief Set the default feed scene.
- *
- * Sends a set scene request with the default feed scene ID and
- * verify the response indicates a successful set action.
- *
- * @return true if the 'set' was successful
- */
-bool MobiusDevice::setFeedScene() {
-    return setScene(Mobius::FEED_SCENE_ID);
-}
-/*!
- * @brief Run the schedule.
- *
- * Sends a request to set the device into the schedule operational
- * state and verify the response indicates a successful action.
- *
- * @return true if the action was successful
- */
-bool MobiusDevice::runSchedule() {
-    uint16_t attSize = sizeof Mobius::ATTRIBUTE_OPERATION_STATE;
-    uint8_t attributes[attSize];
-    memcpy(attributes, Mobius::ATTRIBUTE_OPERATION_STATE, attSize);
-    // update which state to set
-    attributes[attSize-1] = Mobius::OPERATION_STATE_SCHEDULE;
-    
-    return setData(attributes, attSize);
-}
-
-
-
-
-/*!
- * Attempt to connect to a Mobius device with the given address.
- *
- * @return a connected BLEDevice if successful, otherwise a neutral BLEDevice
- */
-bool MobiusDevice::connectTo(String address) {
-    _device = BLEDevice();
-    Serial.print("Scanning for BLE device (");
-    Serial.print(address);
-    Serial.print(')');
-    uint16_t blue[] = { blueLed };
-    // start scanning for a Mobius device with the give address
-    for (uint8_t i = 0; !BLE.scanForAddress(address) && i < 4; i++) {
-        // attempt to start the scan 4 times before moving on
-        Serial.print('.');
-        blinkLEDs(1, blue);
-        if (debug) {
-            Serial.print(" (scan failed to start) ");
-        }
-    }
-
-    // scan up to 26 times (~13 sec)
-    for (uint8_t i = 0; !_device && i < 26; i++) {
-        _device = BLE.available();
-        if (!_device) {
-            // didn't find the device
-            Serial.print('.');
-            blinkLEDs(1, blue);
-        }
-    }
-
-    // stop scanning for the device
-    BLE.stopScan();
-    Serial.println();
-
-    if (_device) {
-        Serial.println("Found the BLE device");
-        if (!connectTo(_device)) {
-            Serial.println("Failed to connect with characteristics");
-            // return a non-initialized device
-            _device = BLEDevice();
-        }
-    }
-    else {
-        Serial.println("BLE device not found");
-        uint16_t red[] = { redLed };
-        blinkLEDs(2, red);
-    }
-
-    return _device;
-}
-/*!
- * @brief Connect to BLEDevice
- *
- * Connect to the given 'peripheral' and check for characteristics.
- * Multiple attempts may be made to both connect and discover characteristics.
- *
- * @return whether the BLEDevice is currently connected
- */
-bool MobiusDevice::connectTo(BLEDevice& peripheral) {
-    // assuming peripheral is NOT null
-    // connect to the device and check for attributes
-    bool hasConnected = false;
-    bool charsConnected = false;
-    // attempt to connect (should only take one)
-    for (uint8_t i = 0; !hasConnected && !charsConnected && i < 2; i++) {
-        // turn on green indicating discovery is happening
-        if (greenLed) digitalWrite(greenLed, ledOn);
-        Serial.print("Connecting ...");
-        hasConnected = peripheral.connect();
-        if (hasConnected) {
-            Serial.println(" Successful");
-            // connected, but no attributes yet
-            // attempt to discover attributes (should only take one)
-            Serial.print("Discovering service ..");
-            for (uint8_t j = 0; !charsConnected && j < 3; j++) {
-                Serial.print('.');
-                if (peripheral.discoverService(Mobius::GENERAL_SERVICE)) {
-                    charsConnected = connectToCharacteristics(peripheral);
-                }
-            }
-            if (charsConnected) {
-                Serial.println(" Successful");
-            }
-            else {
-                // could connect BUT not discover required characteristics
-                // disconnect from the device
-                Serial.println(" Failed");
-                peripheral.disconnect();
-            }
-        }
-        else {
-            // didn't connect to  the device
-            Serial.println(" Failed");
-        }
-    }
-    // turn off green indicating discovery is complete
-    if (greenLed) digitalWrite(greenLed, ledOff);
-    return charsConnected;
-}
-/*!
- * @brief Connect to relevant characteristics
- *
- * Connect to the relevant characteristics on the given 'peripheral' for sending
- * and receiving messages.
- * - REQUEST_CHARACTERISTIC must be found and writable
- * - RESPONSE_CHARACTERISTIC_1 must be found and subscribed to
- * - RESPONSE_CHARACTERISTIC_2 must be found and subscribed to
- *
- * @return true only if all the required characteristics are connected/ready
- */
-bool MobiusDevice::connectToCharacteristics(BLEDevice& peripheral) {
-    if (debug) {
-        Serial.print("connectToCharacteristics() -> peripheral:");
-        Serial.println(peripheral.address());
-    };
-    // assuming peripheral is connected
-    // get the "request" characteristic
-    _requestChar = peripheral.characteristic(Mobius::REQUEST_CHARACTERISTIC);
-    bool hasRequestChar = _requestChar && _requestChar.canWrite();
-    // get the "response" characteristics
-    BLECharacteristic responseChar1 = peripheral.characteristic(Mobius::RESPONSE_CHARACTERISTIC_1);
-    bool hasResponseChar1 = responseChar1 && responseChar1.canSubscribe() && responseChar1.subscribe();
-    _responseChar = peripheral.characteristic(Mobius::RESPONSE_CHARACTERISTIC_2);
-    bool hasResponseChar2 = _responseChar && _responseChar.canSubscribe() && _responseChar.subscribe();
-
-    if (!hasRequestChar || !hasResponseChar1 || !hasResponseChar2) {
-        uint16_t yellow[] = { redLed, greenLed };  //yellow
-        blinkLEDs(6, yellow); // ~ 3 seconds
-        // reset characteristics to unconnected objects
-        _requestChar = BLECharacteristic();
-        _responseChar = BLECharacteristic();
-    }
-    if (debug) {
-        Serial.print("connectToCharacteristics() -> ");
-        Serial.print("hasRequestChar:");
-        Serial.print(hasRequestChar);
-        Serial.print(" hasResponseChar1:");
-        Serial.print(hasResponseChar1);
-        Serial.print(" hasResponseChar2:");
-        Serial.println(hasResponseChar1);
-    }
-    return hasRequestChar && hasResponseChar1 && hasResponseChar2;
-}
-/*!
- * Send a "set" request with the given 'data' (of size 'length').
- *
- * @return true if verification was requested and the response was valid,
- * or if verification was skipped
- */
-bool MobiusDevice::setData(uint8_t* data, uint16_t length, bool doVerification) {
-    // build a request to SET data on a device
-    uint16_t reqSize;
-    uint8_t* req = buildRequest(data, length, Mobius::OP_CODE_SET, 0x0800, reqSize);
-    uint16_t resSize;
-    uint8_t* res = sendRequest(req, reqSize, resSize);
-
-    bool verified = false;
-    // verify the response
-    if (0 < resSize && doVerification) {
-        verified = responseSuccessful(req, reqSize, res, resSize);
-    }
-    // cleanup sent request & returned response from memory
-    delete[] req;
-    delete[] res;
-
-    return verified || !doVerification;
-}
-/*!
- * Send a "get" request with the given 'data' (of size 'length') and parse
- * out the data portion of the response.
- * Sets the value in the given 'dataSize' address to the data's total size.
- *
- * @return the a pointer to the byte array (data)
- */
-uint8_t* MobiusDevice::getData(uint8_t* data, uint16_t length, uint16_t& dataSize) {
-    // build a request to GET data on a device
-    uint16_t reqSize;
-    uint8_t* req = buildRequest(data, length, Mobius::OP_CODE_GET, 0x0000, reqSize);
-    uint16_t resSize;
-    uint8_t* res = sendRequest(req, reqSize, resSize);
-    // current assumes the response is for the current request
-    uint8_t* responseData = parseResponseData(res, resSize, dataSize);
-    // cleanup sent request & returned response from memory
-    delete[] req;
-    delete[] res;
-
-    if (debug) {
-        Serial.print("getData() -> responseData:");
-        for (int i=0; i<dataSize; i++) {
-            Serial.print(" 0x");
-            Serial.print(responseData[i], HEX);
-        }
-        Serial.println();
-    }
-    return responseData;
-}
-/*!
- * Build a byte array representing a Mobius request message.
- * Sets the value in the given 'requestSize' address to the request's total size.
- *
- * @return a pointer to the byte array (request)
- */
-uint8_t* MobiusDevice::buildRequest(uint8_t* data, uint16_t length, uint8_t opCode, uint16_t reserved, uint16_t& requestSize) {
-    requestSize = length + 11;
-    uint8_t* request = new uint8_t[requestSize];
-
-    // first byte is always 02
-    request[0] = 0x02;
-    // opGroup
-    request[1] = Mobius::OP_GROUP_REQUEST;  // C2CI_Request
-    // opCode
-    request[2] = opCode;
-    // mMessageId
-    request[3] = lowByte(_messageId); // little endian
-    request[4] = highByte(_messageId);// little endian
-    _messageId++;
-    // mReserved
-    request[5] = highByte(reserved);
-    request[6] = lowByte(reserved);
-    // data size
-    request[7] = lowByte(length); // little endian
-    request[8] = highByte(length);// little endian
-    // data
-    for (uint16_t i = 0; i < length; i++) {
-        request[9 + i] = data[i];
-    }
-
-    short crc = MobiusCRC::crc16(&request[1], requestSize - 3);
-    request[requestSize - 2] = (uint8_t)crc;// lowByte(length)
-    request[requestSize - 1] = (uint8_t)(crc >> 8); // highByet(length)
-
-    if (debug) {
-        Serial.print("buildRequest() -> request:");
-        for (int i=0; i<requestSize; i++) {
-            Serial.print(" 0x");
-            Serial.print(request[i], HEX);
-        }
-        Serial.println();
-    }
-
-    return request;
-}
-/*!
- * Writes the given 'request' (of size 'length') to the request characteristic.
- * Sets the value in the given 'responseSize' address to the response's total size.
- * Max response size is currently 255.
- *
- * @return a pointer to the byte array (response)
- */
-uint8_t* MobiusDevice::sendRequest(uint8_t* request, uint16_t length, uint16_t& responseSize) {
-    if (debug) {
-        Serial.print("sendRequest() -> request:");
-        for (int i=0; i<length; i++) {
-            Serial.print(" 0x");
-            Serial.print(request[i], HEX);
-        }
-        Serial.println();
-    }
-    // setup response info
-    responseSize = 0;
-    uint8_t* response = new uint8_t[0];
-    // get a copy of the request to write
-    uint8_t toSend[length];
-    memcpy(toSend, request, length);
-    // do the actual writing to the characteristic
-    bool sent = _requestChar.writeValue(toSend, length);
-
-    bool received = false;
-    // look for a response (should only take one)
-    Serial.print("Waiting for response ..");
-    for (uint8_t i = 0; sent && !received && i < 5; i++) {
-        Serial.print('.');
-        uint16_t lightBlue[] = { blueLed, greenLed }; // light blue
-        blinkLEDs(1, lightBlue);
-        if (_responseChar.valueUpdated()) {
-            uint8_t responseValue[255];
-            responseSize = _responseChar.readValue(responseValue, sizeof responseValue);
-            // cleanup response and copy the data to be returned
-            delete[] response;
-            response = new uint8_t[responseSize];
-            memcpy(response, responseValue, responseSize);
-            received = 0 < responseSize;
-        }
-    }
-    Serial.println((received ? " Successful" : " Failed"));
-    if (debug) {
-        Serial.print("sendRequest() -> response:");
-        for (int i=0; i<responseSize; i++) {
-            Serial.print(" 0x");
-            Serial.print(response[i], HEX);
-        }
-        Serial.println();
-    }
-
-    return response;
-}
-/*!
- * Parse the response to get extract the data.
- * Sets the value in the given 'dataSize' address to the data's total size.
- *
- * @return a pointer to the byte array (data)
- */
-uint8_t* MobiusDevice::parseResponseData(uint8_t* response, uint16_t length, uint16_t& dataSize) {
-    // setup default data info
-    dataSize = 0;
-    uint8_t* data = new uint8_t[0];
-    // check response info
-    bool isValid = (length > 11);
-    isValid = isValid && (0x02 == response[0]);
-    isValid = isValid && (Mobius::OP_GROUP_CONFIRM == response[1]);
-    if (isValid) {
-        // get the data 
-        dataSize = (response[8] << 8) + (response[7]);
-        // cleanup data and copy the data to be returned
-        delete[] data;
-        data = new uint8_t[dataSize];
-        memcpy(data, &response[9], dataSize);
-    }
-    if (debug) {
-        Serial.print("parseResponseData() -> data:");
-        for (int i=0; i< dataSize; i++) {
-            Serial.print(" 0x");
-            Serial.print(data[i], HEX);
-        }
-        Serial.println();
-    }
-
-    return data;
-}
-/*!
- * Validate the given 'response' (of size 'resSize') for the given 'request' (of size 'reqSize').
- *
- * @return true only if the response is a success message for the request
- */
-bool MobiusDevice::responseSuccessful(uint8_t* request, uint16_t reqSize, uint8_t* response, uint16_t resSize) {
-    bool idValid = false;
-    bool dataSuccess = false;
-    bool lengthsValid = (reqSize > 11) && (resSize > 11);
-    if (lengthsValid) {
-        // check first 5 bytes (which should match)
-        idValid = (request[0] == response[0]);
-        idValid = idValid && (response[1] == Mobius::OP_GROUP_CONFIRM); // C2CI_Confirm
-        idValid = idValid && (request[2] == response[2]);
-        idValid = idValid && (request[3] == response[3]);
-        idValid = idValid && (request[4] == response[4]);
-        // check the data
-        int dataSize = (response[8] << 8) + (response[7]);
-        uint8_t resData[dataSize];
-        dataSuccess = (3 == dataSize);
-        dataSuccess = dataSuccess && (0x00 == response[9]); // all response data starts with 0x00
-        for (int i = 0; dataSuccess && i < dataSize - 1; i++) {
-            resData[i] = response[10 + i];
-            dataSuccess = dataSuccess && response[10 + i] == Mobius::RESPONSE_DATA_SUCCESSFUL[i];
-        }
-    }
-    // check CRC of the response
-    // skipping CRC validation for now because it seems to be different
-    // Mobius app doesn't seem to be checking either
-    //  short crc = crc16(&response[1], resSize-3);
-    //  bool crcValid = (response[resSize-2] == (byte) crc) && (response[resSize-1] = (byte) (crc >> 8));
-    if (debug) {
-        Serial.print("responseSuccessful() -> lengthsValid:");
-        Serial.print(lengthsValid);
-        Serial.print(" idValid:");
-        Serial.print(idValid);
-        Serial.print(" dataSuccess:");
-        Serial.println(dataSuccess);
-    }
-    // skipping the CRC validation for now
-    return lengthsValid && idValid /*&& crcValid*/ && dataSuccess;
-}
-
-
-
-/*!
- * @brief Blink LEDs
- *
- * Blink the LED specified by 'led' a total of 'count' times.
- * Each "blink" will last for 500 ms.
- */
-void MobiusDevice::blinkLEDs(uint16_t count, uint16_t leds[])
-{
-    // wait for 250 milliseconds during each on / off phase
-    uint8_t delayCount = 250;
-
-    for (short i = 0; i < count; i++) {
-        // set the initial start time value
-        unsigned long startMillis = millis();
-        // turn on all the given LEDs
-        for (uint8_t j = 0; j < sizeof leds; j++) {
-            if (leds[j]) digitalWrite(leds[j], ledOn);
-        }
-        // delaying without sleeping
-        while (delayCount > (millis() - startMillis)) {}
-        // reset the start time value
-        startMillis = millis();
-        // turn off all the given LEDs
-        for (uint8_t j = 0; j < sizeof leds; j++) {
-            if (leds[j]) digitalWrite(leds[j], ledOff);
-        }
-        // delaying without sleeping
-        while (delayCount > (millis() - startMillis)) {}
-    }
-}
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include "MobiusDevice.h"
+#if defined(__AVR__) && !defined(MOBIUS_DISABLE_SLEEP)
+#include <avr/sleep.h>
+#endif
+#include "MobiusCRC.h"
+#include "MobiusCache.h"
+#include "MobiusScanner.h"
+#include "MobiusTrace.h"
+// the connection handle and parameter update aren't exposed by BLEDevice
+#include "utility/ATT.h"
+#include "utility/HCI.h"
+
+/*!
+ * @return a view of the given 'address' bytes, for tracing
+ */
+static MobiusSpan addressData(const MobiusAddress& address) {
+    return MobiusSpan(address.bytes(), MobiusAddress::SIZE);
+}
+
+
+/*!
+ * Unsigned integer of the PIN number for the red LED.
+ */
+uint16_t MobiusDevice::redLed = 0;
+/*!
+ * Unsigned integer of the PIN number for the blue LED.
+ */
+uint16_t MobiusDevice::blueLed = 0;
+/*!
+ * Unsigned integer of the PIN number for the green LED.
+ */
+uint16_t MobiusDevice::greenLed = 0;
+/*!
+ * Unsigned integer of the value to turn ON a LED.
+ * Defaults to "LOW"
+ */
+uint16_t MobiusDevice::ledOn = LOW;
+/*!
+ * Unsigned integer of the value to turn OFF a LED.
+ * Defaults to "HIGH"
+ */
+uint16_t MobiusDevice::ledOff = HIGH;
+/*!
+ * Boolean determining whether to log all trace events to "Serial" while
+ * no MobiusTrace sink is set. Slows requests down considerably.
+ */
+bool MobiusDevice::debug = false;
+/*!
+ * Unsigned long of the longest milliseconds to wait for a response before
+ * a request fails, shorter once the device's round trip time is known.
+ * Defaults to 2500
+ */
+unsigned long MobiusDevice::responseTimeout = 2500;
+/*!
+ * Unsigned long of the milliseconds between reconnect attempts of a session.
+ * Defaults to 5000
+ */
+unsigned long MobiusDevice::reconnectInterval = 5000;
+/*!
+ * Unsigned long of the idle milliseconds after which a session sends a
+ * keep-alive request, 0 disables keep-alive requests.
+ * Defaults to 60000
+ */
+unsigned long MobiusDevice::keepAliveInterval = 60000;
+/*!
+ * Unsigned long of the milliseconds to scan for a device before connecting fails.
+ * Defaults to 13000
+ */
+unsigned long MobiusDevice::scanTimeout = 13000;
+/*!
+ * Unsigned long of the milliseconds a device is assumed to still be advertising
+ * after it was last seen, within which connecting skips the scan.
+ * Defaults to 10000
+ */
+unsigned long MobiusDevice::lastSeenTimeout = 10000;
+/*!
+ * Boolean determining whether responses with an invalid CRC are rejected.
+ * Off until the CRC of responses has been confirmed on a captured device
+ * response, invalid CRCs are still counted in the stats.
+ * Defaults to false
+ */
+bool MobiusDevice::verifyCrc = false;
+/*!
+ * Boolean determining whether responses carry their CRC high byte
+ * first, unlike requests (which carry it low byte first).
+ * Defaults to false
+ */
+bool MobiusDevice::responseCrcSwapped = false;
+/*!
+ * Unsigned long of the milliseconds a device's cached attribute values
+ * (current scene, operation state) stay valid, 0 disables the cache.
+ * Defaults to 0
+ */
+unsigned long MobiusDevice::attributeCacheTimeout = 0;
+/*!
+ * Connection profile applied while requests are being sent.
+ * Defaults to a 7.5 - 15 ms interval without latency (ArduinoBLE's own)
+ * and a 2 s supervision timeout
+ */
+MobiusDevice::ConnectionProfile MobiusDevice::burstProfile = { 6, 12, 0, 200 };
+/*!
+ * Connection profile applied once a connection is idle.
+ * Defaults to a 100 - 200 ms interval, skipping up to 4 connection
+ * events, and a 6 s supervision timeout
+ */
+MobiusDevice::ConnectionProfile MobiusDevice::idleProfile = { 80, 160, 4, 600 };
+/*!
+ * Unsigned long of the milliseconds without requests after which a
+ * connection switches to the 'idleProfile', 0 leaves the connection
+ * parameters to ArduinoBLE.
+ * Defaults to 0
+ */
+unsigned long MobiusDevice::idleProfileTimeout = 0;
+/*!
+ * Connections of the connected devices, also used to route BLE events.
+ */
+MobiusDevice::Connection MobiusDevice::_connections[MOBIUS_MAX_CONNECTIONS];
+/*!
+ * Buffer for building requests, which are written one at a time.
+ */
+uint8_t MobiusDevice::_frame[MOBIUS_MAX_REQUEST_SIZE];
+MobiusFrameWriter MobiusDevice::_writer(_frame, sizeof _frame);
+/*!
+ * Assemblers receiving responses, each used by one device until its response is complete.
+ */
+MobiusFrameAssembler MobiusDevice::_assemblers[MOBIUS_MAX_ASSEMBLERS];
+MobiusDevice* MobiusDevice::_assemblerOwners[MOBIUS_MAX_ASSEMBLERS] = { };
+#ifndef MOBIUS_DISABLE_LEDS
+/*!
+ * Current LED pattern and its progress.
+ */
+MobiusDevice::Indicator MobiusDevice::_indicator = MobiusDevice::INDICATOR_OFF;
+uint8_t MobiusDevice::_indicatorBlinks = 0;
+bool MobiusDevice::_indicatorLit = false;
+unsigned long MobiusDevice::_indicatorMillis = 0;
+#endif
+
+/*!
+ * @brief Scan for BLEDevices
+ *
+ * Performs a scan for nearby BLEDevices which have a name of "MOBIUS".
+ * Any found devices will have their corresponding addresses added to the
+ * give 'addressBuffer' (of 'bufferSize' entries). Scanning continues
+ * while each round of 1 second finds new devices, for up to 3 rounds.
+ * Uses the MobiusScanner, which is left running if it already was.
+ *
+ * @return number of found devices (number of addresses added)
+ */
+uint8_t MobiusDevice::scanForMobiusDevices(MobiusAddress addressBuffer[], uint8_t bufferSize) {
+    uint8_t count = 0;
+    MOBIUS_TRACE(LEVEL_INFO, PHASE_SCAN, 0, 0);
+    bool wasScanning = MobiusScanner::scanning();
+    if (MobiusScanner::begin()) {
+        unsigned long scanMillis = millis();
+        uint8_t seen = 0;
+        indicate(INDICATOR_SCANNING);
+        // scan in rounds of 1 second, until a round finds no new devices
+        for (uint8_t i = 0; i < 3; i++) {
+            unsigned long startMillis = millis();
+            while (1000 > (millis() - startMillis)) {
+                updateIndicators();
+                MobiusScanner::poll();
+                idle();
+            }
+            if (MobiusScanner::count() == seen && seen) {
+                break;
+            }
+            seen = MobiusScanner::count();
+        }
+        indicate(INDICATOR_OFF);
+        // add the addresses of the devices seen during this scan
+        for (uint8_t i = 0; i < MobiusScanner::count() && count < bufferSize; i++) {
+            const MobiusScanner::Entry* entry = MobiusScanner::entry(i);
+            if ((millis() - entry->lastSeenMillis) <= (millis() - scanMillis)) {
+                addressBuffer[count++] = entry->address;
+                MOBIUS_TRACE(LEVEL_DEBUG, PHASE_SCAN_FOUND, 0, count, addressData(addressBuffer[count - 1]));
+            }
+        }
+        MOBIUS_TRACE(LEVEL_INFO, PHASE_SCAN_DONE, 0, count);
+    } else {
+        MOBIUS_TRACE(LEVEL_ERROR, PHASE_SCAN_FAILED, 0, 0);
+    }
+    if (!wasScanning) {
+        MobiusScanner::end();
+    }
+    return count;
+}
+/*!
+ * @brief Scan for BLEDevices
+ *
+ * Same as above, adding the addresses as text ("aa:bb:cc:dd:ee:ff").
+ *
+ * @return number of found devices (number of addresses added)
+ */
+uint8_t MobiusDevice::scanForMobiusDevices(String addressBuffer[], uint8_t bufferSize) {
+    // the registry never holds more devices than the scanner size
+    MobiusAddress found[MOBIUS_SCANNER_SIZE];
+    uint8_t count = scanForMobiusDevices(found, (MOBIUS_SCANNER_SIZE < bufferSize) ? MOBIUS_SCANNER_SIZE : bufferSize);
+    for (uint8_t i = 0; i < count; i++) {
+        addressBuffer[i] = found[i].toString();
+    }
+    return count;
+}
+/*!
+ * @brief List the known Mobius devices
+ *
+ * Adds the addresses of the devices in the MobiusCache (of devices
+ * connected before, possibly before a reset when the cache is
+ * persisted) to the given 'addressBuffer' (of 'bufferSize' entries),
+ * the most recently connected first. Takes no time, so requests can
+ * be sent to known devices straight after starting up instead of
+ * waiting for scanForMobiusDevices().
+ *
+ * @return number of known devices (number of addresses added)
+ */
+uint8_t MobiusDevice::knownMobiusDevices(MobiusAddress addressBuffer[], uint8_t bufferSize) {
+    uint8_t count = 0;
+    for (uint8_t i = MobiusCache::count(); i > 0 && count < bufferSize; i--) {
+        addressBuffer[count++] = MobiusCache::entry(i - 1)->address;
+    }
+    return count;
+}
+
+
+/*!
+ * @brief Sleep until the next interrupt.
+ *
+ * Lets the MCU sleep until a BLE (or any other) interrupt or the next
+ * timer tick wakes it, about a millisecond at most. All waits of the
+ * library sleep this way, unless MOBIUS_DISABLE_SLEEP is defined.
+ *
+ * @return the microseconds slept
+ */
+unsigned long MobiusDevice::idle() {
+#if defined(MOBIUS_DISABLE_SLEEP)
+    return 0;
+#else
+    unsigned long startMicros = micros();
+#if defined(ARDUINO_ARCH_MBED)
+    // mbed OS runs BLE in its own thread, its idle thread sleeps until the next event
+    delay(1);
+#elif defined(__arm__)
+    // any interrupt (BLE, USB or the millisecond tick) wakes the core
+    __asm__ volatile ("wfi");
+#elif defined(__AVR__)
+    // the timer keeps running (and waking) in idle mode
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+#else
+    // no known way to sleep, keep spinning
+    return 0;
+#endif
+    return micros() - startMicros;
+#endif
+}
+
+/*!
+ * Default constructor.
+ */
+MobiusDevice::MobiusDevice() {
+    resetStats();
+}
+
+/*!
+ * Constructs a new MobiusDevice which has the given address.
+ */
+MobiusDevice::MobiusDevice(const MobiusAddress& address) {
+    _address = address;
+    resetStats();
+}
+/*!
+ * Constructs a new MobiusDevice which has the given address ("aa:bb:cc:dd:ee:ff").
+ */
+MobiusDevice::MobiusDevice(String address) : MobiusDevice(MobiusAddress(address.c_str())) {
+}
+/*!
+ * De-construct the class.
+ */
+MobiusDevice::~MobiusDevice() {
+    disconnect();
+}
+/*!
+ * @brief Connect to the device.
+ *
+ * Connect to the device corresponding to the current address and
+ * verify it has the required BLE characteristics.
+ * Does nothing if the device is already connected.
+ *
+ * @return true only if successfully connected
+ */
+bool MobiusDevice::connect() {
+    if (connected()) {
+        // keep the current connection and message IDs
+        return true;
+    }
+    if (!_policy.allow()) {
+        // kept failing, don't scan for it until the circuit breaker allows a trial
+        _stats.breakerRejections++;
+        _reconnectMillis = millis();
+        return false;
+    }
+    // rest the message count/ID
+    // starting with 2, because why not?
+    _messageId = 2;
+    bool isConnected = _transport ? _transport->connect(*this) : connectTo(_address);
+    if (isConnected) {
+        _policy.connected();
+        MobiusCapture::record(_address, MobiusCapture::TYPE_CONNECT, addressData(_address));
+    }
+    else {
+        _policy.failure(false);
+    }
+    _activityMillis = millis();
+    _reconnectMillis = millis();
+    return isConnected;
+}
+/*!
+ * @brief Disconnect from the device.
+ *
+ * Disconnect from the currently connected device, leaving the connections
+ * of other devices up. An active session will reconnect on the next poll()
+ * or request.
+ *
+ * @return true if no longer connected
+ */
+bool MobiusDevice::disconnect() {
+    bool disconnected = true;
+    // fail anything still waiting on this connection
+    failRequests();
+    // persist the scenes changed while connected
+    MobiusCache::flush();
+    if (_transport) {
+        _transport->disconnect();
+        return disconnected;
+    }
+    if (_connection && _connection->peripheral) {
+        // the device starts advertising again once disconnected
+        MobiusScanner::record(_connection->peripheral);
+        disconnected = _connection->peripheral.disconnect();
+    }
+    releaseConnection();
+    if (!anyConnected()) {
+        // nothing else is using BLE, clear any straggling connections
+        BLE.disconnect();
+    }
+    return disconnected;
+}
+/*!
+ * @return true if the device is connected with the required characteristics
+ */
+bool MobiusDevice::connected() {
+    if (_transport) {
+        return _transport->connected();
+    }
+    return _connection && _connection->request && _connection->peripheral.connected();
+}
+/*!
+ * @brief Begin a persistent session.
+ *
+ * Connect to the device and keep the connection up between requests.
+ * While the session is active poll() notices lost connections, sends
+ * keep-alive requests when idle and reconnects every 'reconnectInterval'.
+ * Requests sent while disconnected reconnect first.
+ *
+ * @return true if the device is now connected
+ */
+bool MobiusDevice::beginSession() {
+    _session = true;
+    return connect();
+}
+/*!
+ * @brief End the persistent session.
+ *
+ * Stop keeping the connection up and disconnect from the device.
+ */
+void MobiusDevice::endSession() {
+    _session = false;
+    disconnect();
+}
+/*!
+ * @brief Get the currently running scene.
+ *
+ * Query the device to determine the currently running scene,
+ * unless it is cached (see attributeCacheTimeout).
+ *
+ * @return an unsigned short
+ */
+uint16_t MobiusDevice::getCurrentScene() {
+    if (cacheValid(_cachedScene)) {
+        _stats.cacheHits++;
+        return _cachedScene.value;
+    }
+    startGetCurrentScene();
+    // status byte followed by the scene's record
+    uint8_t body[1 + Mobius::CurrentScene::SET_SIZE];
+    uint16_t bodySize = getData(body, sizeof body);
+    return sceneFromData(MobiusSpan(body, bodySize));
+}
+/*!
+ * @brief Set a new scene.
+ *
+ * Sends a set scene request with the given 'sceneId' and verify
+ * the response indicates a successful set action. Nothing is sent
+ * if the cached current scene already is 'sceneId'.
+ *
+ * @return true if the 'set' was successful
+ */
+bool MobiusDevice::setScene(uint16_t sceneId) {
+    if (cacheValid(_cachedScene) && sceneId == _cachedScene.value) {
+        // already running
+        _stats.cacheHits++;
+        return true;
+    }
+    startSetScene(sceneId);
+    return setData();
+}
+/*!
+ * @brief Set the default feed scene.
+ *
+ * Sends a set scene request with the default feed scene ID and
+ * verify the response indicates a successful set action.
+ *
+ * @return true if the 'set' was successful
+ */
+bool MobiusDevice::setFeedScene() {
+    return setScene(Mobius::FEED_SCENE_ID);
+}
+/*!
+ * @brief Run the schedule.
+ *
+ * Sends a request to set the device into the schedule operational
+ * state and verify the response indicates a successful action.
+ * Nothing is sent if the cached operation state already is the schedule.
+ *
+ * @return true if the action was successful
+ */
+bool MobiusDevice::runSchedule() {
+    if (cacheValid(_cachedState) && Mobius::OPERATION_STATE_SCHEDULE == _cachedState.value) {
+        // already running
+        _stats.cacheHits++;
+        return true;
+    }
+    startRunSchedule();
+    return setData();
+}
+/*!
+ * @brief Begin getting the currently running scene.
+ *
+ * Sends a get scene request without waiting for the response. Up to
+ * MOBIUS_MAX_IN_FLIGHT requests may be waiting for responses. The given
+ * 'handler' is called from poll() once the response has arrived or the
+ * request has timed out. Use sceneFromData() to read the scene ID.
+ *
+ * @return true if the request was sent
+ */
+bool MobiusDevice::beginGetCurrentScene(RequestHandler handler) {
+    startGetCurrentScene();
+    return beginRequest(handler);
+}
+/*!
+ * @brief Begin setting a new scene.
+ *
+ * Sends a set scene request with the given 'sceneId' without waiting
+ * for the response. The given 'handler' is called from poll() once the
+ * response has been verified or the request has timed out.
+ *
+ * @return true if the request was sent
+ */
+bool MobiusDevice::beginSetScene(uint16_t sceneId, RequestHandler handler) {
+    startSetScene(sceneId);
+    return beginRequest(handler);
+}
+/*!
+ * @brief Begin setting the default feed scene.
+ *
+ * Sends a set scene request with the default feed scene ID without
+ * waiting for the response.
+ *
+ * @return true if the request was sent
+ */
+bool MobiusDevice::beginSetFeedScene(RequestHandler handler) {
+    return beginSetScene(Mobius::FEED_SCENE_ID, handler);
+}
+/*!
+ * @brief Begin running the schedule.
+ *
+ * Sends a request to set the device into the schedule operational
+ * state without waiting for the response.
+ *
+ * @return true if the request was sent
+ */
+bool MobiusDevice::beginRunSchedule(RequestHandler handler) {
+    startRunSchedule();
+    return beginRequest(handler);
+}
+/*!
+ * @brief Get several attributes with one request.
+ *
+ * Sends the "get" records of the given 'batch' as a single request and
+ * copies the data portion of the response into the given 'buffer' (of
+ * size 'bufferSize'). Use MobiusBatch::value() to read each attribute.
+ *
+ * @return the data's total size, 0 if the request failed
+ */
+uint16_t MobiusDevice::getBatch(const MobiusBatch& batch, uint8_t* buffer, uint16_t bufferSize) {
+    if (Mobius::OP_CODE_GET != batch.opCode()) {
+        return 0;
+    }
+    startBatch(batch);
+    return getData(buffer, bufferSize);
+}
+/*!
+ * @brief Set several attributes with one request.
+ *
+ * Sends the "set" records of the given 'batch' as a single request and
+ * verify the response indicates a successful set action.
+ *
+ * @return true if the 'set' was successful
+ */
+bool MobiusDevice::setBatch(const MobiusBatch& batch) {
+    if (Mobius::OP_CODE_SET != batch.opCode()) {
+        return false;
+    }
+    startBatch(batch);
+    return setData();
+}
+/*!
+ * @brief Begin a batched request.
+ *
+ * Sends the records of the given 'batch' as a single "get" or "set"
+ * request without waiting for the response. The given 'handler' is
+ * called from poll() once the response has arrived or the request
+ * has timed out.
+ *
+ * @return true if the request was sent
+ */
+bool MobiusDevice::beginBatch(const MobiusBatch& batch, RequestHandler handler) {
+    if (!batch.opCode()) {
+        return false;
+    }
+    startBatch(batch);
+    return beginRequest(handler);
+}
+/*!
+ * @brief Prepare setting a new scene.
+ *
+ * Builds the set scene request with the given 'sceneId' into the given
+ * 'prepared' request, to be sent later by beginPrepared(). With an
+ * 'idleProfileTimeout' the 'burstProfile' is applied straight away,
+ * so it is in effect by the time the request is sent.
+ *
+ * @return true if the request was prepared
+ */
+bool MobiusDevice::prepareSetScene(uint16_t sceneId, PreparedRequest& prepared) {
+    prepared.size = 0;
+    startSetScene(sceneId);
+    uint16_t requestSize = _writer.finish();
+    if (!requestSize || sizeof prepared.frame < requestSize || !(_transport || _connection)) {
+        return false;
+    }
+    // the message ID is taken now, so requests sent meanwhile don't reuse it
+    _messageId++;
+    memcpy(prepared.frame, _frame, requestSize);
+    prepared.size = requestSize;
+    prepared.setAttributeId = _setAttributeId;
+    prepared.setValue = _setValue;
+    _profileMillis = millis();
+    if (idleProfileTimeout && PROFILE_BURST != _profile) {
+        applyProfile(PROFILE_BURST);
+    }
+    return true;
+}
+/*!
+ * @brief Begin a prepared request.
+ *
+ * Sends the given 'prepared' request without waiting for the response.
+ * The given 'handler' is called from poll() once the response has been
+ * verified or the request has timed out. A request is sent once, or not
+ * at all if it was prepared before the device (re)connected.
+ *
+ * @return true if the request was sent
+ */
+bool MobiusDevice::beginPrepared(PreparedRequest& prepared, RequestHandler handler) {
+    uint16_t preparedId = prepared.frame[3] | (prepared.frame[4] << 8);
+    // message IDs restart on every connection, a stale ID may be reused
+    bool current = prepared.size && 0x8000 > (uint16_t)(_messageId - 1 - preparedId);
+    if (!current || !canBegin()) {
+        return false;
+    }
+    if (!beginFrame(prepared.frame, prepared.size, prepared.setAttributeId, prepared.setValue, handler, nullptr)) {
+        return false;
+    }
+    prepared.size = 0;
+    return true;
+}
+/*!
+ * @brief Process BLE events for the device.
+ *
+ * Polls the BLE stack, completes a request whose response has arrived
+ * and fails a request which has exceeded the 'responseTimeout'.
+ * Should be called from the main loop while a request is pending,
+ * or continuously while a session is active.
+ *
+ * @return true if a request is still pending
+ */
+bool MobiusDevice::poll() {
+    // let ArduinoBLE (or the transport) process events, this calls onResponseUpdated()
+    if (_transport) {
+        _transport->poll();
+    }
+    else {
+        BLE.poll();
+    }
+    MobiusScanner::poll();
+    MobiusCache::poll();
+    updateIndicators();
+    // pick up updates which were not delivered by the event handlers
+    if (_connection && _connection->data && _connection->data.valueUpdated()) {
+        receiveData();
+    }
+    if (_connection && _connection->response && _connection->response.valueUpdated()) {
+        receiveResponse();
+    }
+    // fail requests without a response in time (newest first, as they are removed)
+    for (int8_t i = _inFlightCount - 1; 0 <= i; i--) {
+        if (i < _inFlightCount && _inFlight[i].timeoutMillis < (millis() - _inFlight[i].sentMillis)) {
+            _stats.timeouts++;
+            _policy.failure(true);
+            finishRequest(i, MobiusSpan());
+        }
+    }
+    maintainSession();
+    maintainProfile();
+    return requestPending();
+}
+/*!
+ * @return true if a request has been sent and is waiting for a response
+ */
+bool MobiusDevice::requestPending() {
+    return 0 < _inFlightCount;
+}
+/*!
+ * @return number of requests sent and waiting for a response
+ */
+uint8_t MobiusDevice::requestsPending() {
+    return _inFlightCount;
+}
+/*!
+ * @return true if the last completed request was successful
+ */
+bool MobiusDevice::lastRequestSuccessful() {
+    return _lastSuccessful;
+}
+/*!
+ * @return the address of the device as text ("aa:bb:cc:dd:ee:ff")
+ */
+String MobiusDevice::address() {
+    return _address.toString();
+}
+/*!
+ * @return the address of the device
+ */
+const MobiusAddress& MobiusDevice::deviceAddress() const {
+    return _address;
+}
+/*!
+ * @return the timings and counters collected since construction or resetStats()
+ */
+const MobiusDevice::Stats& MobiusDevice::stats() {
+    return _stats;
+}
+/*!
+ * @brief Clear the collected timings and counters.
+ */
+void MobiusDevice::resetStats() {
+    memset(&_stats, 0, sizeof _stats);
+    _stats.sinceMillis = millis();
+}
+/*!
+ * @brief Carry frames over the given 'transport'.
+ *
+ * Replaces the ArduinoBLE characteristics with the given 'transport'
+ * (e.g. a MobiusSimulator), null restores them. Should be set while
+ * disconnected.
+ */
+void MobiusDevice::setTransport(MobiusTransport* transport) {
+    _transport = transport;
+}
+/*!
+ * Record a phase which took the given 'micros'.
+ */
+void MobiusDevice::Timing::add(uint32_t micros) {
+    if (!count || micros < minMicros) {
+        minMicros = micros;
+    }
+    if (micros > maxMicros) {
+        maxMicros = micros;
+    }
+    totalMicros += micros;
+    count++;
+}
+/*!
+ * @return the average duration in microseconds, 0 if none were recorded
+ */
+uint32_t MobiusDevice::Timing::averageMicros() const {
+    return count ? (uint32_t)(totalMicros / count) : 0;
+}
+/*!
+ * @brief Change the parameters of the connection.
+ *
+ * Asks the BLE controller to update the connection to the given
+ * 'profile'. With an 'idleProfileTimeout' the 'burstProfile' and
+ * 'idleProfile' are applied automatically around requests instead.
+ *
+ * @return true if the update was requested
+ */
+bool MobiusDevice::setConnectionProfile(const ConnectionProfile& profile) {
+    if (_transport || !connected()) {
+        return false;
+    }
+    // BLEDevice hides the address type, so try a public then a random address
+    uint16_t handle = ATT.connectionHandle(0x00, _address.bytes());
+    if (0xFFFF == handle) {
+        handle = ATT.connectionHandle(0x01, _address.bytes());
+    }
+    if (0xFFFF == handle) {
+        return false;
+    }
+    bool requested = 0 == HCI.leConnUpdate(handle, profile.minInterval, profile.maxInterval,
+        profile.latency, profile.supervisionTimeout);
+    if (requested) {
+        _stats.profileChanges++;
+        _profile = PROFILE_CUSTOM;
+    }
+    return requested;
+}
+/*!
+ * @return the device's round trip estimate, response timeout and circuit breaker
+ */
+MobiusRetryPolicy& MobiusDevice::retryPolicy() {
+    return _policy;
+}
+/*!
+ * @return the percentage of the time since collecting started
+ * the MCU was awake (100 if it never slept)
+ */
+uint8_t MobiusDevice::Stats::dutyCycle() const {
+    uint64_t elapsedMicros = (uint64_t)(millis() - sinceMillis) * 1000;
+    if (!elapsedMicros || sleepMicros >= elapsedMicros) {
+        return elapsedMicros ? 0 : 100;
+    }
+    return 100 - (uint8_t)(sleepMicros * 100 / elapsedMicros);
+}
+/*!
+ * @return the cached current scene, or 0xFFFF if not cached (or expired)
+ */
+uint16_t MobiusDevice::cachedScene() {
+    return cacheValid(_cachedScene) ? _cachedScene.value : 0xFFFF;
+}
+/*!
+ * @return the cached operation state, or 0xFF if not cached (or expired)
+ */
+uint8_t MobiusDevice::cachedOperationState() {
+    return cacheValid(_cachedState) ? _cachedState.value : 0xFF;
+}
+/*!
+ * @brief Forget the cached attribute values.
+ *
+ * Call when the device may have been changed by someone else
+ * (e.g. the Mobius app), the next reads query the device again.
+ */
+void MobiusDevice::invalidateCache() {
+    _cachedScene.valid = false;
+    _cachedState.valid = false;
+}
+/*!
+ * @brief Subscribe to changes of an attribute.
+ *
+ * Call the given 'handler' from poll() whenever the device reports on
+ * its own (e.g. when its schedule changes the scene) a new value of the
+ * attribute with the given 'attributeId'. Replaces the handler of an
+ * existing subscription to the attribute.
+ *
+ * @return true if subscribed, false if MOBIUS_MAX_SUBSCRIPTIONS are in use
+ */
+bool MobiusDevice::subscribe(uint16_t attributeId, AttributeHandler handler) {
+    Subscription* unused = nullptr;
+    for (uint8_t i = 0; i < MOBIUS_MAX_SUBSCRIPTIONS; i++) {
+        Subscription& subscription = _subscriptions[i];
+        if (subscription.handler && attributeId == subscription.attributeId) {
+            subscription.handler = handler;
+            return true;
+        }
+        if (!unused && !subscription.handler) {
+            unused = &subscription;
+        }
+    }
+    if (!unused || !handler) {
+        return !handler;
+    }
+    *unused = { attributeId, handler };
+    return true;
+}
+/*!
+ * @brief Unsubscribe from changes of an attribute.
+ */
+void MobiusDevice::unsubscribe(uint16_t attributeId) {
+    subscribe(attributeId, nullptr);
+}
+/*!
+ * Extract the scene ID from the 'data' of a get scene response.
+ *
+ * @return the scene ID, or 0xFFFF if the data is too short
+ */
+uint16_t MobiusDevice::sceneFromData(MobiusSpan data) {
+    uint16_t scene = -1;
+    Mobius::CurrentScene::read(data, scene);
+    return scene;
+}
+
+
+
+
+/*!
+ * Attempt to connect to a Mobius device with the given address.
+ * A device seen within the 'lastSeenTimeout' (by a device or the
+ * MobiusScanner) is connected without scanning, otherwise the scan stops
+ * as soon as the device is found or 'scanTimeout' passes.
+ * A background scan is paused while connecting.
+ *
+ * @return a connected BLEDevice if successful, otherwise a neutral BLEDevice
+ */
+bool MobiusDevice::connectTo(const MobiusAddress& address) {
+    if (!claimConnection()) {
+        // as many devices as MOBIUS_MAX_CONNECTIONS are connected
+        MOBIUS_TRACE(LEVEL_ERROR, PHASE_CONNECT_FAILED, 0, 0, addressData(address));
+        return false;
+    }
+    bool resumeScan = MobiusScanner::pause();
+    bool isConnected = connectToAddress(address);
+    if (!isConnected) {
+        releaseConnection();
+    }
+    if (resumeScan) {
+        MobiusScanner::resume();
+    }
+    return isConnected;
+}
+/*!
+ * Attempt to connect to a Mobius device with the given address, see connectTo().
+ *
+ * @return true if connected
+ */
+bool MobiusDevice::connectToAddress(const MobiusAddress& address) {
+    BLEDevice& peripheral = _connection->peripheral;
+    indicate(INDICATOR_CONNECTING);
+    // the registry holds the devices seen by the scanner and by connecting devices
+    const MobiusScanner::Entry* entry = MobiusScanner::find(address);
+    if (entry && lastSeenTimeout > (millis() - entry->lastSeenMillis)) {
+        // the device should still be advertising, connect straight away
+        peripheral = entry->device;
+        if (connectTo(peripheral)) {
+            return true;
+        }
+        // no longer reachable, fall back to scanning
+        MobiusScanner::forget(address);
+        indicate(INDICATOR_CONNECTING);
+    }
+
+    peripheral = scanFor(address);
+    if (peripheral) {
+        MobiusScanner::record(peripheral);
+        if (!connectTo(peripheral)) {
+            // return a non-initialized device
+            peripheral = BLEDevice();
+        }
+    }
+    else {
+        MOBIUS_TRACE(LEVEL_ERROR, PHASE_NOT_FOUND, 0, 0, addressData(address));
+        indicate(INDICATOR_NOT_FOUND, 2);
+    }
+
+    return peripheral;
+}
+/*!
+ * Scan for the Mobius device with the given address (for up to 'scanTimeout').
+ *
+ * @return the found BLEDevice, otherwise a neutral BLEDevice
+ */
+BLEDevice MobiusDevice::scanFor(const MobiusAddress& address) {
+    BLEDevice device;
+    MOBIUS_TRACE(LEVEL_INFO, PHASE_SCAN, 0, 0, addressData(address));
+    unsigned long startMillis = millis();
+    unsigned long startMicros = micros();
+    // ArduinoBLE filters scans by the address text
+    String text = address.toString();
+    // start scanning for a Mobius device with the give address
+    for (uint8_t i = 0; !BLE.scanForAddress(text) && i < 4; i++) {
+        // attempt to start the scan 4 times before moving on
+        MOBIUS_TRACE(LEVEL_DEBUG, PHASE_SCAN_FAILED, 0, i + 1);
+        _stats.scanRetries++;
+        pause(_policy.backoff(i));
+    }
+
+    // scan until the first advertisement of the device arrives
+    while (!device && scanTimeout > (millis() - startMillis)) {
+        updateIndicators();
+        device = BLE.available();
+        if (!device) {
+            waitForEvent();
+        }
+    }
+
+    // stop scanning for the device
+    BLE.stopScan();
+    if (device) {
+        _stats.scan.add(micros() - startMicros);
+        MOBIUS_TRACE(LEVEL_DEBUG, PHASE_SCAN_FOUND, 0, 1, addressData(address));
+    }
+    return device;
+}
+/*!
+ * @brief Connect to BLEDevice
+ *
+ * Connect to the given 'peripheral' and check for characteristics.
+ * Multiple attempts may be made to both connect and discover characteristics.
+ *
+ * @return whether the BLEDevice is currently connected
+ */
+bool MobiusDevice::connectTo(BLEDevice& peripheral) {
+    // assuming peripheral is NOT null
+    // connect to the device and check for attributes
+    bool hasConnected = false;
+    bool charsConnected = false;
+    // attempt to connect (should only take one)
+    for (uint8_t i = 0; !hasConnected && !charsConnected && i < 2; i++) {
+        // turn on green indicating discovery is happening
+        indicate(INDICATOR_DISCOVERING);
+        MOBIUS_TRACE(LEVEL_INFO, PHASE_CONNECT, 0, i + 1, addressData(_address));
+        if (i) {
+            _stats.connectRetries++;
+        }
+        unsigned long startMicros = micros();
+        hasConnected = peripheral.connect();
+        if (hasConnected) {
+            _stats.connect.add(micros() - startMicros);
+            MOBIUS_TRACE(LEVEL_INFO, PHASE_CONNECTED, 0, 0);
+            // connected, but no attributes yet
+            // attempt to discover attributes (should only take one)
+            for (uint8_t j = 0; !charsConnected && j < 3; j++) {
+                if (j) {
+                    _stats.discoverRetries++;
+                }
+                startMicros = micros();
+                if (peripheral.discoverService(Mobius::GENERAL_SERVICE)) {
+                    _stats.discover.add(micros() - startMicros);
+                    startMicros = micros();
+                    charsConnected = connectToCharacteristics(peripheral);
+                    if (charsConnected) {
+                        _stats.subscribe.add(micros() - startMicros);
+                    }
+                }
+            }
+            if (charsConnected) {
+                MOBIUS_TRACE(LEVEL_INFO, PHASE_DISCOVERED, 0, 0);
+            }
+            else {
+                // could connect BUT not discover required characteristics
+                // disconnect from the device
+                MOBIUS_TRACE(LEVEL_ERROR, PHASE_DISCOVER_FAILED, 0, 0);
+                peripheral.disconnect();
+            }
+        }
+        else {
+            // didn't connect to  the device
+            MOBIUS_TRACE(LEVEL_ERROR, PHASE_CONNECT_FAILED, 0, 0);
+        }
+    }
+    if (!charsConnected) {
+        _stats.connectFailures++;
+    }
+    // turn off green indicating discovery is complete
+    clearIndicator(INDICATOR_DISCOVERING);
+    return charsConnected;
+}
+/*!
+ * @brief Connect to relevant characteristics
+ *
+ * Connect to the relevant characteristics on the given 'peripheral' for sending
+ * and receiving messages.
+ * - REQUEST_CHARACTERISTIC must be found and writable
+ * - RESPONSE_CHARACTERISTIC_1 must be found and subscribed to
+ * - RESPONSE_CHARACTERISTIC_2 must be found and subscribed to
+ * Known devices use the characteristic indices from the MobiusCache.
+ *
+ * @return true only if all the required characteristics are connected/ready
+ */
+bool MobiusDevice::connectToCharacteristics(BLEDevice& peripheral) {
+    MobiusAddress address(peripheral.address().c_str());
+    // assuming peripheral is connected
+    const MobiusCache::Entry* cached = MobiusCache::find(address);
+    BLECharacteristic& requestChar = _connection->request;
+    BLECharacteristic& dataChar = _connection->data;
+    BLECharacteristic& responseChar = _connection->response;
+    bool cacheValid = false;
+    if (cached) {
+        // go straight to the cached characteristics
+        requestChar = peripheral.characteristic(cached->requestIndex);
+        dataChar = peripheral.characteristic(cached->rxDataIndex);
+        responseChar = peripheral.characteristic(cached->rxFinalIndex);
+        // make sure the device didn't change
+        cacheValid = requestChar && 0 == strcasecmp(requestChar.uuid(), Mobius::REQUEST_CHARACTERISTIC);
+        cacheValid = cacheValid && dataChar && 0 == strcasecmp(dataChar.uuid(), Mobius::RESPONSE_CHARACTERISTIC_1);
+        cacheValid = cacheValid && responseChar && 0 == strcasecmp(responseChar.uuid(), Mobius::RESPONSE_CHARACTERISTIC_2);
+    }
+    int8_t requestIndex = -1;
+    int8_t rxDataIndex = -1;
+    int8_t rxFinalIndex = -1;
+    if (!cacheValid) {
+        // find all the characteristics in a single pass
+        int charCount = peripheral.characteristicCount();
+        for (int i = 0; i < charCount && (requestIndex < 0 || rxDataIndex < 0 || rxFinalIndex < 0); i++) {
+            BLECharacteristic characteristic = peripheral.characteristic(i);
+            const char* uuid = characteristic.uuid();
+            if (0 == strcasecmp(uuid, Mobius::REQUEST_CHARACTERISTIC)) {
+                requestChar = characteristic;
+                requestIndex = i;
+            } else if (0 == strcasecmp(uuid, Mobius::RESPONSE_CHARACTERISTIC_1)) {
+                dataChar = characteristic;
+                rxDataIndex = i;
+            } else if (0 == strcasecmp(uuid, Mobius::RESPONSE_CHARACTERISTIC_2)) {
+                responseChar = characteristic;
+                rxFinalIndex = i;
+            }
+        }
+        if (requestIndex < 0) requestChar = BLECharacteristic();
+        if (rxDataIndex < 0) dataChar = BLECharacteristic();
+        if (rxFinalIndex < 0) responseChar = BLECharacteristic();
+    }
+    // get the "request" characteristic
+    bool hasRequestChar = requestChar && requestChar.canWrite();
+    // get the "response" characteristics
+    bool hasResponseChar1 = dataChar && dataChar.canSubscribe() && dataChar.subscribe();
+    bool hasResponseChar2 = responseChar && responseChar.canSubscribe() && responseChar.subscribe();
+
+    if (!hasRequestChar || !hasResponseChar1 || !hasResponseChar2) {
+        indicate(INDICATOR_NO_CHARACTERISTICS, 6); // ~ 3 seconds
+        if (cached) {
+            // the cached details didn't help, search by UUID next time
+            MobiusCache::forget(address);
+        }
+        // reset characteristics to unconnected objects
+        requestChar = BLECharacteristic();
+        dataChar = BLECharacteristic();
+        responseChar = BLECharacteristic();
+    }
+    else {
+        // route RX_FINAL updates and lost connections to this device
+        dataChar.setEventHandler(BLEUpdated, onDataUpdated);
+        responseChar.setEventHandler(BLEUpdated, onResponseUpdated);
+        BLE.setEventHandler(BLEDisconnected, onDisconnected);
+        // a new connection starts with ArduinoBLE's parameters
+        _profile = PROFILE_DEFAULT;
+        _profileUpdating = false;
+        _profileMillis = millis();
+        if (!cacheValid) {
+            // remember where the characteristics are for next time
+            MobiusCache::store(address, requestIndex, rxDataIndex, rxFinalIndex);
+        }
+    }
+    MOBIUS_TRACE(LEVEL_DEBUG, PHASE_CHARACTERISTICS, 0, hasRequestChar + hasResponseChar1 + hasResponseChar2);
+    return hasRequestChar && hasResponseChar1 && hasResponseChar2;
+}
+/*!
+ * Send the "set" request written since startRequest().
+ *
+ * @return true if verification was requested and the response was valid,
+ * or if verification was skipped
+ */
+bool MobiusDevice::setData(bool doVerification) {
+    // send a request to SET data on a device
+    uint16_t messageId;
+    bool verified = beginRequest(nullptr, &messageId) && waitForRequest(messageId);
+
+    return verified || !doVerification;
+}
+/*!
+ * Send the "get" request written since startRequest() and copy the
+ * data portion of the response into the given 'buffer' (of size 'bufferSize').
+ *
+ * @return the data's total size, 0 if the request failed
+ */
+uint16_t MobiusDevice::getData(uint8_t* buffer, uint16_t bufferSize) {
+    // send a request to GET data on a device
+    _dataBuffer = buffer;
+    _dataBufferSize = bufferSize;
+    _dataSize = 0;
+    uint16_t messageId;
+    if (beginRequest(storeData, &messageId)) {
+        waitForRequest(messageId);
+    }
+    _dataBuffer = nullptr;
+    _dataBufferSize = 0;
+    return _dataSize;
+}
+/*!
+ * Start writing a request with the given 'opCode' and 'reserved' value
+ * carrying 'length' bytes of data, which the caller writes into the
+ * returned writer before calling beginRequest().
+ *
+ * @return the writer of the shared request frame
+ */
+MobiusFrameWriter& MobiusDevice::startRequest(uint8_t opCode, uint16_t reserved, uint16_t length) {
+    if (_session && !_inFlightCount && !connected()) {
+        // lazily reconnect an active session, before the shared frame is written
+        connect();
+    }
+    _writer.begin(Mobius::OP_GROUP_REQUEST, opCode, _messageId, reserved, length);
+    _setAttributeId = 0;
+    return _writer;
+}
+/*!
+ * Send the request written since startRequest() without waiting for the
+ * response. The 'handler' is called when the request completes.
+ * Sets the value in the given 'messageId' address (if any) to the request's message ID.
+ *
+ * @return true if the request was sent
+ */
+bool MobiusDevice::beginRequest(RequestHandler handler, uint16_t* messageId) {
+    if (!canBegin()) {
+        return false;
+    }
+    // the CRC has been updated while the frame was written
+    uint16_t requestSize = _writer.finish();
+    if (!requestSize) {
+        // too large for the request buffer
+        return false;
+    }
+    _messageId++;
+    return beginFrame(_frame, requestSize, _setAttributeId, _setValue, handler, messageId);
+}
+/*!
+ * @return true if another request may be sent
+ */
+bool MobiusDevice::canBegin() {
+    if (MOBIUS_MAX_IN_FLIGHT <= _inFlightCount || !(_transport || _connection)) {
+        // no room to track another request on a connected device
+        return false;
+    }
+    if (!_policy.allow()) {
+        // the device keeps failing, fail fast
+        _stats.breakerRejections++;
+        return false;
+    }
+    return true;
+}
+/*!
+ * Send the given request 'frame' (of size 'frameSize') setting the attribute
+ * with the given 'setAttributeId' (if any) to 'setValue', see beginRequest().
+ *
+ * @return true if the request was sent
+ */
+bool MobiusDevice::beginFrame(const uint8_t* frame, uint16_t frameSize, uint16_t setAttributeId, uint16_t setValue,
+        RequestHandler handler, uint16_t* messageId) {
+    InFlight& request = _inFlight[_inFlightCount];
+    request.messageId = frame[3] | (frame[4] << 8);
+    request.opCode = frame[2];
+    request.keepAlive = false;
+    request.handler = handler;
+    request.sentMillis = millis();
+    request.sentMicros = micros();
+    request.setAttributeId = setAttributeId;
+    request.setValue = setValue;
+    if (!_inFlightCount) {
+        // drop any stale updates so only responses to this request complete it
+        if (_connection) {
+            _connection->data.valueUpdated();
+            _connection->response.valueUpdated();
+        }
+        releaseAssembler();
+        _fragmentDropped = false;
+    }
+    _profileMillis = millis();
+    if (idleProfileTimeout && PROFILE_BURST != _profile) {
+        // speed the connection up before the request goes out
+        applyProfile(PROFILE_BURST);
+    }
+    // the update takes effect some idle connection events later, the round trips
+    // measured on the burst profile don't apply until a response has arrived
+    bool slow = _profileUpdating || PROFILE_IDLE == _profile;
+    request.timeoutMillis = slow ? responseTimeout : _policy.timeout();
+    if (!sendRequest(frame, frameSize)) {
+        return false;
+    }
+    // track the request until its response arrives
+    _inFlightCount++;
+    if (messageId) {
+        *messageId = request.messageId;
+    }
+    // blink light blue indicating a request is pending
+    indicate(INDICATOR_REQUEST);
+    return true;
+}
+/*!
+ * Start a request getting the current scene.
+ */
+void MobiusDevice::startGetCurrentScene() {
+    Mobius::CurrentScene::writeGet(startRequest(Mobius::OP_CODE_GET, 0x0000, Mobius::CurrentScene::GET_SIZE));
+}
+/*!
+ * Start a request setting the scene with the given 'sceneId'.
+ */
+void MobiusDevice::startSetScene(uint16_t sceneId) {
+    MobiusFrameWriter& writer = startRequest(Mobius::OP_CODE_SET, 0x0800, Mobius::CurrentScene::SET_SIZE);
+    Mobius::CurrentScene::writeSet(writer, sceneId);
+    _setAttributeId = Mobius::ATTRIBUTE_ID_CURRENT_SCENE;
+    _setValue = sceneId;
+}
+/*!
+ * Start a request setting the schedule operational state.
+ */
+void MobiusDevice::startRunSchedule() {
+    MobiusFrameWriter& writer = startRequest(Mobius::OP_CODE_SET, 0x0800, Mobius::OperationState::SET_SIZE);
+    Mobius::OperationState::writeSet(writer, Mobius::OPERATION_STATE_SCHEDULE);
+    _setAttributeId = Mobius::ATTRIBUTE_ID_OPERATION_STATE;
+    _setValue = Mobius::OPERATION_STATE_SCHEDULE;
+}
+/*!
+ * Start a request carrying the records of the given 'batch'.
+ */
+void MobiusDevice::startBatch(const MobiusBatch& batch) {
+    uint16_t reserved = (Mobius::OP_CODE_SET == batch.opCode()) ? 0x0800 : 0x0000;
+    MobiusSpan records = batch.data();
+    startRequest(batch.opCode(), reserved, records.size()).write(records.data(), records.size());
+}
+/*!
+ * @return true if the given 'attribute' holds a value within the 'attributeCacheTimeout'
+ */
+bool MobiusDevice::cacheValid(const CachedAttribute& attribute) {
+    return attribute.valid && attributeCacheTimeout > (millis() - attribute.storedMillis);
+}
+/*!
+ * Cache the given 'value' of the attribute with the given 'attributeId',
+ * forgetting values which may have changed along with it.
+ */
+void MobiusDevice::cacheAttribute(uint16_t attributeId, uint16_t value) {
+    CachedAttribute* attribute = nullptr;
+    if (Mobius::ATTRIBUTE_ID_CURRENT_SCENE == attributeId) {
+        attribute = &_cachedScene;
+    }
+    else if (Mobius::ATTRIBUTE_ID_OPERATION_STATE == attributeId) {
+        attribute = &_cachedState;
+    }
+    // a scene change may change the operation state and vice versa
+    invalidateCache();
+    if (attribute) {
+        attribute->value = value;
+        attribute->storedMillis = millis();
+        attribute->valid = true;
+    }
+    if (&_cachedScene == attribute) {
+        MobiusCache::storeScene(_address, value);
+    }
+}
+/*!
+ * Update the cache after the given completed 'request' with the
+ * given response 'data' (if 'successful').
+ */
+void MobiusDevice::updateCache(const InFlight& request, bool successful, MobiusSpan data) {
+    if (Mobius::OP_CODE_SET == request.opCode) {
+        // a failed (or unknown) set leaves the device in an unknown state
+        cacheAttribute(successful ? request.setAttributeId : 0, request.setValue);
+        return;
+    }
+    if (successful) {
+        cacheValues(data);
+    }
+}
+/*!
+ * Cache the attribute values in the given "get" response 'data'.
+ */
+void MobiusDevice::cacheValues(MobiusSpan data) {
+    uint16_t scene;
+    uint8_t state;
+    unsigned long now = millis();
+    if (Mobius::CurrentScene::read(data, scene)) {
+        _cachedScene = { scene, now, true };
+        MobiusCache::storeScene(_address, scene);
+    }
+    if (Mobius::OperationState::read(data, state)) {
+        _cachedState = { state, now, true };
+    }
+}
+/*!
+ * Handle the given unsolicited 'response', updating the cache and
+ * calling the subscribed handlers of the attributes it carries.
+ */
+void MobiusDevice::notificationReceived(MobiusSpan response) {
+    _stats.notifications++;
+    MobiusSpan data = parseResponseData(response);
+    MOBIUS_TRACE(LEVEL_INFO, PHASE_NOTIFICATION, response[3] | (response[4] << 8), data.size(), data);
+    // what else changed along with the reported values is unknown
+    invalidateCache();
+    cacheValues(data);
+    for (uint8_t i = 0; i < MOBIUS_MAX_SUBSCRIPTIONS; i++) {
+        Subscription& subscription = _subscriptions[i];
+        if (!subscription.handler) {
+            continue;
+        }
+        MobiusSpan value = MobiusBatch::value(data, subscription.attributeId);
+        if (value.size()) {
+            subscription.handler(*this, subscription.attributeId, value);
+        }
+    }
+}
+/*!
+ * @return index of the in flight request with the given 'messageId', or -1 if unknown
+ */
+int8_t MobiusDevice::findInFlight(uint16_t messageId) {
+    for (uint8_t i = 0; i < _inFlightCount; i++) {
+        if (messageId == _inFlight[i].messageId) {
+            return i;
+        }
+    }
+    return -1;
+}
+/*!
+ * Writes the given 'request' (of size 'length') to the request characteristic.
+ * The response is delivered to receiveResponse().
+ *
+ * @return true if the request was written
+ */
+bool MobiusDevice::sendRequest(const uint8_t* request, uint16_t length) {
+    uint16_t messageId = request[3] | (request[4] << 8);
+    // do the actual writing to the characteristic
+    unsigned long startMicros = micros();
+    bool sent = _transport ? _transport->write(request, length) : _connection->request.writeValue(request, length);
+    if (sent) {
+        _stats.write.add(micros() - startMicros);
+        _stats.requestsSent++;
+        _stats.bytesSent += length;
+        MOBIUS_TRACE(LEVEL_INFO, PHASE_REQUEST_SENT, messageId, length, MobiusSpan(request, length));
+        MobiusCapture::record(_address, MobiusCapture::TYPE_REQUEST, MobiusSpan(request, length));
+    }
+    else {
+        MOBIUS_TRACE(LEVEL_ERROR, PHASE_SEND_FAILED, messageId, length);
+    }
+    return sent;
+}
+/*!
+ * Read an RX_DATA fragment of the response being received.
+ */
+void MobiusDevice::receiveData() {
+    // clear the updated flag, the value is read below
+    _connection->data.valueUpdated();
+    dataReceived(receiveFragment(_connection->data, MobiusCapture::TYPE_DATA));
+}
+/*!
+ * Note whether an RX_DATA fragment was 'stored', a dropped fragment
+ * fails the response once it is complete.
+ */
+void MobiusDevice::dataReceived(bool stored) {
+    MOBIUS_TRACE(LEVEL_DEBUG, PHASE_FRAGMENT, 0, _assembler ? _assembler->frame().size() : 0);
+    if (!stored) {
+        // the response can't be completed, fail it once RX_FINAL arrives
+        _fragmentDropped = true;
+    }
+}
+/*!
+ * Read the final part of a response from the response characteristic and
+ * complete the request with the response's message ID.
+ */
+void MobiusDevice::receiveResponse() {
+    // clear the updated flag, the value is read below
+    _connection->response.valueUpdated();
+    responseReceived(receiveFragment(_connection->response, MobiusCapture::TYPE_FINAL));
+}
+/*!
+ * Complete the request with the message ID of the response, whose final
+ * part has been received ('stored' tells whether it could be kept).
+ */
+void MobiusDevice::responseReceived(bool stored) {
+    bool complete = stored && !_fragmentDropped;
+    MobiusSpan response = _assembler ? _assembler->frame() : MobiusSpan();
+    _fragmentDropped = false;
+    // the CRC was updated as the fragments arrived
+    bool crcValid = complete && _assembler->crcValid(responseCrcSwapped);
+    uint16_t responseId = (5 <= response.size()) ? (response[3] | (response[4] << 8)) : 0;
+    MOBIUS_TRACE(LEVEL_DEBUG, PHASE_RESPONSE, responseId, response.size(), response);
+    if (complete && !crcValid) {
+        _stats.crcErrors++;
+        // report the expected CRC instead of a size
+        MOBIUS_TRACE(LEVEL_ERROR, PHASE_CRC_INVALID, responseId, _assembler->crc());
+    }
+    // reject a corrupt response, its request fails
+    complete = complete && (crcValid || !verifyCrc);
+    // the response carries the message ID of its request
+    int8_t index = -1;
+    if (5 <= response.size()) {
+        index = findInFlight(responseId);
+    }
+    if (0 > index && !complete && _inFlightCount) {
+        // can't tell which request was lost, responses arrive in order
+        index = 0;
+    }
+    if (0 <= index && !complete) {
+        // the device answered, but not usably
+        _policy.failure(false);
+    }
+    if (0 <= index) {
+        finishRequest(index, complete ? response : MobiusSpan());
+    }
+    else if (complete) {
+        // an unsolicited update, the device changed on its own
+        notificationReceived(response);
+    }
+    // the response (and data) is no longer needed
+    releaseAssembler();
+}
+/*!
+ * Append the value of the given 'characteristic' to the response being
+ * received, capturing it as a fragment of the given 'type' (even if it can't
+ * be stored).
+ *
+ * @return false if the fragment couldn't be stored
+ */
+bool MobiusDevice::receiveFragment(BLECharacteristic& characteristic, MobiusCapture::Type type) {
+    int length = characteristic.valueLength();
+    // capture fragments which are dropped below as well, they are what a replay is for
+    MobiusCapture::record(_address, type, MobiusSpan(characteristic.value(), (0 < length) ? length : 0));
+    MobiusFrameAssembler* assembler = claimAssembler();
+    if (!assembler) {
+        MOBIUS_TRACE(LEVEL_ERROR, PHASE_NO_ASSEMBLER, 0, length);
+        return false;
+    }
+    // read straight into the frame
+    if (length > assembler->remaining()) {
+        // too big for what is left of the frame
+        return false;
+    }
+    int read = characteristic.readValue(assembler->tail(), length);
+    _stats.bytesReceived += (0 < read) ? read : 0;
+    return assembler->appended((0 < read) ? read : 0);
+}
+/*!
+ * Append the given 'fragment' (of size 'length') to the response being
+ * received, capturing it as a fragment of the given 'type' (even if it can't
+ * be stored).
+ *
+ * @return false if the fragment couldn't be stored
+ */
+bool MobiusDevice::receiveFragment(const uint8_t* fragment, uint16_t length, MobiusCapture::Type type) {
+    // capture fragments which are dropped below as well, they are what a replay is for
+    MobiusCapture::record(_address, type, MobiusSpan(fragment, length));
+    MobiusFrameAssembler* assembler = claimAssembler();
+    if (!assembler) {
+        MOBIUS_TRACE(LEVEL_ERROR, PHASE_NO_ASSEMBLER, 0, length);
+        return false;
+    }
+    _stats.bytesReceived += length;
+    return assembler->append(fragment, length);
+}
+/*!
+ * @return the device's assembler, claiming a free one if needed (null if none are free)
+ */
+MobiusFrameAssembler* MobiusDevice::claimAssembler() {
+    for (uint8_t i = 0; !_assembler && i < MOBIUS_MAX_ASSEMBLERS; i++) {
+        if (!_assemblerOwners[i]) {
+            _assemblerOwners[i] = this;
+            _assembler = &_assemblers[i];
+            _assembler->reset();
+        }
+    }
+    return _assembler;
+}
+/*!
+ * Return the device's assembler (if any) to the free assemblers.
+ */
+void MobiusDevice::releaseAssembler() {
+    for (uint8_t i = 0; _assembler && i < MOBIUS_MAX_ASSEMBLERS; i++) {
+        if (this == _assemblerOwners[i]) {
+            _assemblerOwners[i] = nullptr;
+        }
+    }
+    _assembler = nullptr;
+}
+/*!
+ * Complete the in flight request at the given 'index' with the given 'response',
+ * an empty response indicates a failure/timeout.
+ */
+void MobiusDevice::finishRequest(uint8_t index, MobiusSpan response) {
+    InFlight request = _inFlight[index];
+    // stop tracking the request first so the handler may begin another
+    _inFlightCount--;
+    for (uint8_t i = index; i < _inFlightCount; i++) {
+        _inFlight[i] = _inFlight[i + 1];
+    }
+    if (!_inFlightCount) {
+        // stop blinking light blue indicating the requests are complete
+        clearIndicator(INDICATOR_REQUEST);
+    }
+
+    MobiusSpan data;
+    bool successful = false;
+    if (!response.empty()) {
+        data = parseResponseData(response);
+        if (Mobius::OP_CODE_SET == request.opCode) {
+            successful = responseSuccessful(request.opCode, request.messageId, response);
+        }
+        else {
+            // matched by message ID, only needs data
+            successful = !data.empty();
+        }
+    }
+    if (!response.empty()) {
+        _stats.confirm.add(micros() - request.sentMicros);
+        if (!successful) {
+            _policy.failure(false);
+        }
+        else if (!_profileUpdating) {
+            // not sampled while the connection was still being sped up
+            _policy.success(micros() - request.sentMicros);
+        }
+    }
+    if (successful) {
+        _stats.requestsSuccessful++;
+        MOBIUS_TRACE(LEVEL_INFO, PHASE_REQUEST_SUCCESSFUL, request.messageId, data.size());
+    }
+    else {
+        _stats.requestsFailed++;
+        MOBIUS_TRACE(LEVEL_ERROR, PHASE_REQUEST_FAILED, request.messageId, response.size());
+    }
+    updateCache(request, successful, data);
+    _profileMillis = millis();
+    _lastSuccessful = successful;
+    if (request.messageId == _waitMessageId) {
+        _waitSuccessful = successful;
+    }
+    if (successful) {
+        _activityMillis = millis();
+        // the connection has been sped up
+        _profileUpdating = false;
+    }
+    if (request.handler) {
+        request.handler(*this, successful, data);
+    }
+    if (request.keepAlive && !successful && connected()) {
+        // the link is up but the device stopped responding, start over
+        disconnect();
+    }
+}
+/*!
+ * Fail all in flight requests.
+ */
+void MobiusDevice::failRequests() {
+    while (_inFlightCount) {
+        finishRequest(0, MobiusSpan());
+    }
+    releaseAssembler();
+}
+/*!
+ * Wait for the request with the given 'messageId' to complete.
+ *
+ * @return true if the request was successful
+ */
+bool MobiusDevice::waitForRequest(uint16_t messageId) {
+    _waitMessageId = messageId;
+    _waitSuccessful = false;
+    // poll() completes the request once the response arrives or times out
+    while (0 <= findInFlight(messageId)) {
+        // sleep until the response (or the next tick) arrives
+        waitForEvent();
+        poll();
+    }
+    _waitMessageId = 0;
+    return _waitSuccessful;
+}
+/*!
+ * Request handler copying the response data into the getData() buffer.
+ */
+void MobiusDevice::storeData(MobiusDevice& device, bool successful, MobiusSpan data) {
+    device._dataSize = 0;
+    if (successful && device._dataBuffer) {
+        device._dataSize = (data.size() < device._dataBufferSize) ? data.size() : device._dataBufferSize;
+        memcpy(device._dataBuffer, data.data(), device._dataSize);
+    }
+}
+/*!
+ * @brief Disconnected event handler.
+ *
+ * Called by ArduinoBLE when a connection is lost, releases the
+ * MobiusDevice connected to the 'peripheral'.
+ */
+void MobiusDevice::onDisconnected(BLEDevice peripheral) {
+    for (uint8_t i = 0; i < MOBIUS_MAX_CONNECTIONS; i++) {
+        Connection& connection = _connections[i];
+        if (connection.device && connection.peripheral == peripheral) {
+            connection.device->connectionLost();
+        }
+    }
+}
+/*!
+ * Release the connection state after the link has been lost.
+ */
+void MobiusDevice::connectionLost() {
+    MOBIUS_TRACE(LEVEL_INFO, PHASE_CONNECTION_LOST, 0, 0, addressData(_address));
+    failRequests();
+    // changes made while disconnected go unnoticed
+    invalidateCache();
+    releaseConnection();
+    // wait a full interval before reconnecting
+    _reconnectMillis = millis();
+}
+/*!
+ * Keep an active session's connection up, reconnecting or sending a
+ * keep-alive request when needed.
+ */
+void MobiusDevice::maintainSession() {
+    if (!_session) {
+        return;
+    }
+    if (!connected()) {
+        if (_connection) {
+            // the link was lost without a disconnected event
+            connectionLost();
+        }
+        if (reconnectInterval <= (millis() - _reconnectMillis)) {
+            connect();
+        }
+    }
+    else if (!_inFlightCount && keepAliveInterval && keepAliveInterval <= (millis() - _activityMillis)) {
+        // idle for too long, check the device is still responding
+        if (beginGetCurrentScene()) {
+            _inFlight[_inFlightCount - 1].keepAlive = true;
+        }
+        _activityMillis = millis();
+    }
+}
+/*!
+ * @brief Response characteristic event handler.
+ *
+ * Called by ArduinoBLE when RESPONSE_CHARACTERISTIC_2 (RX_FINAL) is updated,
+ * forwards the response to the MobiusDevice connected to the 'peripheral'.
+ */
+void MobiusDevice::onResponseUpdated(BLEDevice peripheral, BLECharacteristic /*characteristic*/) {
+    for (uint8_t i = 0; i < MOBIUS_MAX_CONNECTIONS; i++) {
+        Connection& connection = _connections[i];
+        if (connection.device && connection.peripheral == peripheral) {
+            connection.device->receiveResponse();
+            return;
+        }
+    }
+}
+/*!
+ * @brief Data characteristic event handler.
+ *
+ * Called by ArduinoBLE when RESPONSE_CHARACTERISTIC_1 (RX_DATA) is updated,
+ * forwards the fragment to the MobiusDevice connected to the 'peripheral'.
+ */
+void MobiusDevice::onDataUpdated(BLEDevice peripheral, BLECharacteristic /*characteristic*/) {
+    for (uint8_t i = 0; i < MOBIUS_MAX_CONNECTIONS; i++) {
+        Connection& connection = _connections[i];
+        if (connection.device && connection.peripheral == peripheral) {
+            connection.device->receiveData();
+            return;
+        }
+    }
+}
+/*!
+ * Claim a pooled connection for this device, which then receives the
+ * BLE events of its peripheral.
+ *
+ * @return true if the device holds a connection, false if all MOBIUS_MAX_CONNECTIONS are in use
+ */
+bool MobiusDevice::claimConnection() {
+    for (uint8_t i = 0; !_connection && i < MOBIUS_MAX_CONNECTIONS; i++) {
+        if (!_connections[i].device) {
+            _connection = &_connections[i];
+            _connection->device = this;
+        }
+    }
+    return _connection;
+}
+/*!
+ * Return the device's connection (if any) to the pool.
+ */
+void MobiusDevice::releaseConnection() {
+    if (!_connection) {
+        return;
+    }
+    // release the BLE objects along with the slot
+    *_connection = Connection();
+    _connection = nullptr;
+}
+/*!
+ * @return true if any MobiusDevice holds a connection
+ */
+bool MobiusDevice::anyConnected() {
+    for (uint8_t i = 0; i < MOBIUS_MAX_CONNECTIONS; i++) {
+        if (_connections[i].device) {
+            return true;
+        }
+    }
+    return false;
+}
+/*!
+ * Parse the response to get extract the data.
+ *
+ * @return a view of the data within the 'response', empty if the response is invalid
+ */
+MobiusSpan MobiusDevice::parseResponseData(MobiusSpan response) {
+    // setup default data info
+    MobiusSpan data;
+    // check response info
+    bool isValid = (response.size() > 11);
+    isValid = isValid && (0x02 == response[0]);
+    isValid = isValid && (Mobius::OP_GROUP_CONFIRM == response[1]);
+    if (isValid) {
+        // get the data, never beyond the end of the response
+        uint16_t dataSize = (response[8] << 8) + (response[7]);
+        data = response.sub(9, dataSize);
+    }
+
+    return data;
+}
+/*!
+ * Validate the given 'response' for the request with the given 'opCode' and 'messageId'.
+ *
+ * @return true only if the response is a success message for the request
+ */
+bool MobiusDevice::responseSuccessful(uint8_t opCode, uint16_t messageId, MobiusSpan response) {
+    bool idValid = false;
+    bool dataSuccess = false;
+    bool lengthsValid = (response.size() > 11);
+    if (lengthsValid) {
+        // check first 5 bytes (which should match the request)
+        idValid = (0x02 == response[0]);
+        idValid = idValid && (response[1] == Mobius::OP_GROUP_CONFIRM); // C2CI_Confirm
+        idValid = idValid && (opCode == response[2]);
+        idValid = idValid && (lowByte(messageId) == response[3]);
+        idValid = idValid && (highByte(messageId) == response[4]);
+        // check the data
+        int dataSize = (response[8] << 8) + (response[7]);
+        dataSuccess = (3 == dataSize);
+        dataSuccess = dataSuccess && (0x00 == response[9]); // all response data starts with 0x00
+        for (int i = 0; dataSuccess && i < dataSize - 1; i++) {
+            dataSuccess = dataSuccess && response[10 + i] == Mobius::RESPONSE_DATA_SUCCESSFUL[i];
+        }
+    }
+    // the CRC has already been checked by receiveResponse()
+    return lengthsValid && idValid && dataSuccess;
+}
+
+
+
+#ifndef MOBIUS_DISABLE_LEDS
+/*!
+ * @brief Update the status LEDs.
+ *
+ * Advances the current LED pattern without blocking. Called internally
+ * while scanning, connecting and polling, it may also be called from the
+ * main loop to keep patterns blinking between library calls.
+ */
+void MobiusDevice::updateIndicators() {
+    // solid patterns don't change, each blink phase lasts 250 milliseconds
+    bool blinking = (INDICATOR_OFF != _indicator) && (INDICATOR_DISCOVERING != _indicator);
+    if (!blinking || 250 > (millis() - _indicatorMillis)) {
+        return;
+    }
+    _indicatorMillis = millis();
+    if (_indicatorLit) {
+        lightIndicator(_indicator, false);
+        _indicatorLit = false;
+        // count down finite patterns, which end after their last blink
+        if (_indicatorBlinks && !--_indicatorBlinks) {
+            _indicator = INDICATOR_OFF;
+        }
+    }
+    else {
+        lightIndicator(_indicator, true);
+        _indicatorLit = true;
+    }
+}
+/*!
+ * @brief Show an LED pattern.
+ *
+ * Replaces the current LED pattern with the given 'indicator'. A blinking
+ * pattern stops after 'blinks' blinks (500 ms each), or continues until
+ * replaced if 'blinks' is 0.
+ */
+void MobiusDevice::indicate(Indicator indicator, uint8_t blinks) {
+    _indicator = indicator;
+    _indicatorBlinks = blinks;
+    _indicatorMillis = millis();
+    // every pattern starts with its LEDs on
+    _indicatorLit = (INDICATOR_OFF != indicator);
+    lightIndicator(indicator, _indicatorLit);
+}
+/*!
+ * Turn the LEDs used by the given 'indicator' on or off, all other LEDs are turned off.
+ */
+void MobiusDevice::lightIndicator(Indicator indicator, bool lit) {
+    bool red = false;
+    bool green = false;
+    bool blue = false;
+    switch (indicator) {
+        case INDICATOR_SCANNING:           red = true;   blue = true;  break; // purple
+        case INDICATOR_CONNECTING:         blue = true;                break;
+        case INDICATOR_DISCOVERING:        green = true;               break;
+        case INDICATOR_NO_CHARACTERISTICS: red = true;   green = true; break; // yellow
+        case INDICATOR_NOT_FOUND:          red = true;                 break;
+        case INDICATOR_REQUEST:            blue = true;  green = true; break; // light blue
+        default: break;
+    }
+    if (redLed) digitalWrite(redLed, (lit && red) ? ledOn : ledOff);
+    if (greenLed) digitalWrite(greenLed, (lit && green) ? ledOn : ledOff);
+    if (blueLed) digitalWrite(blueLed, (lit && blue) ? ledOn : ledOff);
+}
+/*!
+ * Turn off the LEDs if the given 'indicator' is still being shown.
+ */
+void MobiusDevice::clearIndicator(Indicator indicator) {
+    if (indicator == _indicator) {
+        indicate(INDICATOR_OFF);
+    }
+}
+#endif
+/*!
+ * Wait for 'ms' milliseconds while keeping the BLE stack and LEDs updated.
+ */
+void MobiusDevice::pause(unsigned long ms) {
+    unsigned long startMillis = millis();
+    while (ms > (millis() - startMillis)) {
+        BLE.poll();
+        MobiusScanner::poll();
+        updateIndicators();
+        idle();
+    }
+}
+/*!
+ * Apply the given connection 'profile' (one of the static profiles).
+ *
+ * @return true if the update was requested
+ */
+bool MobiusDevice::applyProfile(Profile profile) {
+    bool fromIdle = PROFILE_IDLE == _profile || _profileUpdating;
+    bool requested = setConnectionProfile(PROFILE_BURST == profile ? burstProfile : idleProfile);
+    if (requested) {
+        _profileUpdating = PROFILE_BURST == profile && fromIdle;
+        _profile = profile;
+    }
+    return requested;
+}
+/*!
+ * Switch an idle connection to the 'idleProfile' after the 'idleProfileTimeout'.
+ */
+void MobiusDevice::maintainProfile() {
+    if (idleProfileTimeout && PROFILE_IDLE != _profile && !_inFlightCount && _connection
+            && idleProfileTimeout <= (millis() - _profileMillis) && !applyProfile(PROFILE_IDLE)) {
+        // don't retry on every poll
+        _profileMillis = millis();
+    }
+}
+/*!
+ * Sleep until the next event (see idle()) while waiting for the device,
+ * counting the time slept. Transports are polled, so they never sleep.
+ */
+void MobiusDevice::waitForEvent() {
+    if (!_transport) {
+        _stats.sleepMicros += idle();
+    }
+}
@@ -1,247 +1,1180 @@
-/*!
- * This file is part of the MobiusBLE library.
- */
-
-#ifndef _MobiusDevice_h
-#define _MobiusDevice_h
-
-#include <cstdint>
-#include <ArduinoBLE.h>
-
-/*!
- * @brief Namespace containing definitions specific for Mobius communication.
- */
-namespace Mobius {
-    static const char GENERAL_SERVICE[] =           "01ff0100-ba5e-f4ee-5ca1-eb1e5e4b1ce0";
-    static const char REQUEST_CHARACTERISTIC[] =    "01ff0104-ba5e-f4ee-5ca1-eb1e5e4b1ce0";//TX_FINAL
-    static const char RESPONSE_CHARACTERISTIC_1[] = "01ff0101-ba5e-f4ee-5ca1-eb1e5e4b1ce0";//RX_DATA
-    static const char RESPONSE_CHARACTERISTIC_2[] = "01ff0102-ba5e-f4ee-5ca1-eb1e5e4b1ce0";//RX_FINAL
-
-    static const uint8_t OP_GROUP_REQUEST = 0xde; // C2CI_Request = -34
-    static const uint8_t OP_GROUP_CONFIRM = 0xdf; // C2CI_Confirm = -33
-    static const uint8_t OP_CODE_GET = 0x17;      // GetC2AttrFsciRequest
-    static const uint8_t OP_CODE_SET = 0x18;      // SetC2AttrFsciRequest
-    static const uint8_t ATTRIBUTE_SCENE[] =          { 0x91, 0x01, 0x00, 0x01, 0x04, 0xFF, 0xFF, 0x00, 0x00 }; // C2Attribute.CurrentScene = 401
-    static const uint8_t ATTRIBUTE_CURRENT_SCENE[]  = { 0x91, 0x01, 0x00, 0x01 }; // C2Attribute.CurrentScene = 401
-    static const uint8_t ATTRIBUTE_OPERATION_STATE[]= {0x68, 0x00, 0x00, 0x01, 0x01, 0xFF}; // C2Attribute.OperationState = 104
-    static const uint8_t RESPONSE_DATA_SUCCESSFUL[] = { 0xFF, 0xFF };
-    static const uint8_t OPERATION_STATE_SCHEDULE = 0x03;
-    static const uint16_t FEED_SCENE_ID = 1;
-}
-
- /*!
-  * @brief Class representing Mobius device.
-  *
-  * This class represents a Mobius device which may be controlled via BLE communication.
-  */
-class MobiusDevice {
-public:
-    /*!
-     * Unsigned integer of the PIN number for the red LED.
-     */
-    static uint16_t redLed;
-    /*!
-     * Unsigned integer of the PIN number for the blue LED.
-     */
-    static uint16_t blueLed;
-    /*!
-     * Unsigned integer of the PIN number for the green LED.
-     */
-    static uint16_t greenLed;
-    /*!
-     * Unsigned integer of the value to turn ON a LED.
-     */
-    static uint16_t ledOn;
-    /*!
-     * Unsigned integer of the value to turn OFF a LED.
-     */
-    static uint16_t ledOff;
-    /*!
-     * Boolean determining whether to log debug statements to "Serial".
-     */
-    static bool debug;
-
-    /*!
-     * @brief Scan for BLEDevices
-     * 
-     * Performs a scan for nearby BLEDevices which have a name of "MOBIUS".
-     * Any found devices will have their corresponding addresses added to the
-     * give 'addressBuffer'.
-     * 
-     * @return number of found devices (number of addresses added)
-     */
-    static uint8_t scanForMobiusDevices(String addressBuffer[]);
-
-
-    /*!
-     * Default constructor.
-     */
-    MobiusDevice();
-    
-    /*!
-     * Constructs a new MobiusDevice which has the given address.
-     */
-    MobiusDevice(String address);
-    
-    /*!
-     * De-construct the class.
-     */
-    ~MobiusDevice();
-
-    /*!
-     * @brief Connect to the device.
-     * 
-     * Connect to the device corresponding to the current address and
-     * verify it has the required BLE characteristics.
-     * 
-     * @return true only if successfully connected
-     */
-    bool connect();
-    
-    /*!
-     * @brief Disconnect from the device.
-     *
-     * Disconnect from the currently connected device.
-     *
-     * @return true if no longer connected
-     */
-    bool disconnect();
-
-    /*!
-     * @brief Get the currently running scene.
-     * 
-     * Query the device to determine the currently running scene.
-     * 
-     * @return an unsigned short
-     */
-    uint16_t getCurrentScene();
-
-    /*!
-     * @brief Set a new scene.
-     * 
-     * Sends a set scene request with the given 'sceneId' and verify
-     * the response indicates a successful set action.
-     * 
-     * @return true if the 'set' was successful
-     */
-    bool setScene(uint16_t sceneId);
-
-    /*!
-     * @brief Set the default feed scene.
-     * 
-     * Sends a set scene request with the default feed scene ID and 
-     * verify the response indicates a successful set action.
-     * 
-     * @return true if the 'set' was successful
-     */
-    bool setFeedScene();
-
-    /*!
-     * @brief Run the schedule.
-     * 
-     * Sends a request to set the device into the schedule operational
-     * state and verify the response indicates a successful action.
-     * 
-     * @return true if the action was successful
-     */
-    bool runSchedule();
-
-
-private:
-    BLEDevice _device;
-    BLECharacteristic _requestChar;
-    BLECharacteristic _responseChar;
-    uint16_t _messageId;
-    String _address;
-
-    /*!
-     * @brief Blink LEDs
-     *
-     * Blink the LED specified by 'led' a total of 'count' times.
-     * Each "blink" will last for 500 ms.
-     */
-    static void blinkLEDs(uint16_t count, uint16_t leds[]);
-
-
-    /*!
-     * Attempt to connect to a Mobius device with the given address.
-     *
-     * @return a connected BLEDevice if successful, otherwise a neutral BLEDevice
-     */
-    bool connectTo(String address);
-
-    /*!
-     * @brief Connect to BLEDevice
-     * 
-     * Connect to the given 'peripheral' and check for characteristics.
-     * Multiple attempts may be made to both connect and discover characteristics.
-     *
-     * @return whether the BLEDevice is currently connected
-     */
-    bool connectTo(BLEDevice& peripheral);
-
-    /*!
-     * @brief Connect to relevant characteristics
-     * 
-     * Connect to the relevant characteristics on the given 'peripheral' for sending
-     * and receiving messages.
-     * - REQUEST_CHARACTERISTIC must be found and writable
-     * - RESPONSE_CHARACTERISTIC_1 must be found and subscribed to
-     * - RESPONSE_CHARACTERISTIC_2 must be found and subscribed to
-     *
-     * @return true only if all the required characteristics are connected/ready
-     */
-    bool connectToCharacteristics(BLEDevice& peripheral);
-    
-    
-    /*!
-     * Send a "set" request with the given 'data' (of size 'length').
-     *
-     * @return true if verification was requested and the response was valid,
-     * or if verification was skipped
-     */
-    bool setData(uint8_t* data, uint16_t length, bool doVerification = true);
-
-    /*!
-     * Send a "get" request with the given 'data' (of size 'length') and parse
-     * out the data portion of the response.
-     * Sets the value in the given 'dataSize' address to the data's total size.
-     *
-     * @return the a pointer to the byte array (data)
-     */
-    uint8_t* getData(uint8_t* data, uint16_t length, uint16_t& dataSize);
-
-    /*!
-     * Build a byte array representing a Mobius request message.
-     * Sets the value in the given 'requestSize' address to the request's total size.
-     *
-     * @return a pointer to the byte array (request)
-     */
-    uint8_t* buildRequest(uint8_t* data, uint16_t length, uint8_t opCode, uint16_t reserved, uint16_t& requestSize);
-
-    /*!
-     * Writes the given 'request' (of size 'length') to the request characteristic.
-     * Sets the value in the given 'responseSize' address to the response's total size.
-     * Max response size is currently 255.
-     * 
-     * @return a pointer to the byte array (response)
-     */
-    uint8_t* sendRequest(uint8_t* request, uint16_t length, uint16_t& responseSize);
-
-    /*!
-     * Parse the response to get extract the data.
-     * Sets the value in the given 'dataSize' address to the data's total size.
-     * 
-     * @return a pointer to the byte array (data)
-     */
-    uint8_t* parseResponseData(uint8_t* response, uint16_t length, uint16_t& dataSize);
-
-    /*!
-     * Validate the given 'response' (of size 'resSize') for the given 'request' (of size 'reqSize').
-     *
-     * @return true only if the response is a success message for the request
-     */
-    bool responseSuccessful(uint8_t* request, uint16_t reqSize, uint8_t* response, uint16_t resSize);
-};
-
-#endif
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusDevice_h
+#define _MobiusDevice_h
+
+#include <cstdint>
+#include <ArduinoBLE.h>
+#include "MobiusSpan.h"
+#include "MobiusAddress.h"
+#include "MobiusAttribute.h"
+#include "MobiusFrame.h"
+#include "MobiusBatch.h"
+#include "MobiusTransport.h"
+#include "MobiusScanner.h"
+#include "MobiusCache.h"
+#include "MobiusCapture.h"
+#include "MobiusRetryPolicy.h"
+
+/*!
+ * @brief Namespace containing definitions specific for Mobius communication.
+ */
+namespace Mobius {
+    static const char GENERAL_SERVICE[] =           "01ff0100-ba5e-f4ee-5ca1-eb1e5e4b1ce0";
+    static const char REQUEST_CHARACTERISTIC[] =    "01ff0104-ba5e-f4ee-5ca1-eb1e5e4b1ce0";//TX_FINAL
+    static const char RESPONSE_CHARACTERISTIC_1[] = "01ff0101-ba5e-f4ee-5ca1-eb1e5e4b1ce0";//RX_DATA
+    static const char RESPONSE_CHARACTERISTIC_2[] = "01ff0102-ba5e-f4ee-5ca1-eb1e5e4b1ce0";//RX_FINAL
+
+    static const uint8_t OP_GROUP_REQUEST = 0xde; // C2CI_Request = -34
+    static const uint8_t OP_GROUP_CONFIRM = 0xdf; // C2CI_Confirm = -33
+    static const uint8_t OP_CODE_GET = 0x17;      // GetC2AttrFsciRequest
+    static const uint8_t OP_CODE_SET = 0x18;      // SetC2AttrFsciRequest
+    // attribute record templates, superseded by the descriptors below
+    static const uint8_t ATTRIBUTE_SCENE[] =          { 0x91, 0x01, 0x00, 0x01, 0x04, 0xFF, 0xFF, 0x00, 0x00 }; // C2Attribute.CurrentScene = 401
+    static const uint8_t ATTRIBUTE_CURRENT_SCENE[]  = { 0x91, 0x01, 0x00, 0x01 }; // C2Attribute.CurrentScene = 401
+    static const uint8_t ATTRIBUTE_OPERATION_STATE[]= {0x68, 0x00, 0x00, 0x01, 0x01, 0xFF}; // C2Attribute.OperationState = 104
+    static const uint8_t RESPONSE_DATA_SUCCESSFUL[] = { 0xFF, 0xFF };
+    static const uint8_t OPERATION_STATE_SCHEDULE = 0x03;
+    static const uint16_t FEED_SCENE_ID = 1;
+    static const uint16_t ATTRIBUTE_ID_OPERATION_STATE = 104; // C2Attribute.OperationState
+    static const uint16_t ATTRIBUTE_ID_CURRENT_SCENE = 401;   // C2Attribute.CurrentScene
+
+    typedef MobiusAttribute<ATTRIBUTE_ID_OPERATION_STATE, uint8_t> OperationState;
+    typedef MobiusAttribute<ATTRIBUTE_ID_CURRENT_SCENE, uint16_t, 4> CurrentScene;
+}
+
+#ifndef MOBIUS_MAX_CONNECTIONS
+/*!
+ * Maximum number of MobiusDevices which may be connected at the same time.
+ */
+#define MOBIUS_MAX_CONNECTIONS 4
+#endif
+
+#ifndef MOBIUS_MAX_IN_FLIGHT
+/*!
+ * Maximum number of requests each MobiusDevice may have waiting for a response.
+ */
+#define MOBIUS_MAX_IN_FLIGHT 4
+#endif
+
+#ifndef MOBIUS_MAX_ASSEMBLERS
+/*!
+ * Number of responses which may be received (reassembled) at the same time.
+ */
+#define MOBIUS_MAX_ASSEMBLERS 2
+#endif
+
+#ifndef MOBIUS_MAX_SUBSCRIPTIONS
+/*!
+ * Maximum number of attributes each MobiusDevice may be subscribed to.
+ */
+#define MOBIUS_MAX_SUBSCRIPTIONS 2
+#endif
+
+ /*!
+  * @brief Class representing Mobius device.
+  *
+  * This class represents a Mobius device which may be controlled via BLE communication.
+  */
+class MobiusDevice {
+public:
+    /*!
+     * @brief Request completion handler.
+     *
+     * Function called once an asynchronous request has completed. The 'data'
+     * is the data portion of the response and is only valid for the duration
+     * of the call.
+     */
+    typedef void (*RequestHandler)(MobiusDevice& device, bool successful, MobiusSpan data);
+
+    /*!
+     * @brief Attribute change handler.
+     *
+     * Function called when the device reports on its own that the attribute
+     * with the given 'attributeId' changed to the given 'value'. The 'value'
+     * is only valid for the duration of the call.
+     */
+    typedef void (*AttributeHandler)(MobiusDevice& device, uint16_t attributeId, MobiusSpan value);
+
+    /*!
+     * @brief Status patterns shown on the configured LEDs.
+     */
+    enum Indicator : uint8_t {
+        INDICATOR_OFF = 0,            // all LEDs off
+        INDICATOR_SCANNING,           // blinking purple (red + blue)
+        INDICATOR_CONNECTING,         // blinking blue
+        INDICATOR_DISCOVERING,        // solid green
+        INDICATOR_NO_CHARACTERISTICS, // blinking yellow (red + green)
+        INDICATOR_NOT_FOUND,          // blinking red
+        INDICATOR_REQUEST             // blinking light blue (blue + green)
+    };
+
+    /*!
+     * @brief Minimum, average and maximum duration of a phase.
+     */
+    struct Timing {
+        uint32_t count;
+        uint32_t minMicros;
+        uint32_t maxMicros;
+        uint64_t totalMicros;
+
+        /*!
+         * Record a phase which took the given 'micros'.
+         */
+        void add(uint32_t micros);
+
+        /*!
+         * @return the average duration in microseconds, 0 if none were recorded
+         */
+        uint32_t averageMicros() const;
+    };
+
+    /*!
+     * @brief Parameters of a connection.
+     *
+     * See the Bluetooth Core Specification (LE Connection Update) for the
+     * allowed ranges.
+     */
+    struct ConnectionProfile {
+        uint16_t minInterval;           // connection interval, in 1.25 ms units
+        uint16_t maxInterval;
+        uint16_t latency;               // connection events the device may skip
+        uint16_t supervisionTimeout;    // in 10 ms units
+    };
+
+    /*!
+     * Size of the largest prepared request, setting one attribute.
+     */
+    static const uint8_t PREPARED_SIZE = 11 + Mobius::CurrentScene::SET_SIZE;
+
+    /*!
+     * @brief Request frame built ahead of time.
+     *
+     * Filled by prepareSetScene() and sent by beginPrepared(), so sending
+     * only costs the write itself.
+     */
+    struct PreparedRequest {
+        uint8_t frame[PREPARED_SIZE];
+        uint8_t size;                   // 0 if nothing is prepared
+        uint16_t setAttributeId;        // attribute (and value) cached once confirmed
+        uint16_t setValue;
+    };
+
+    /*!
+     * @brief Timings and counters of a device's connections and requests.
+     */
+    struct Stats {
+        Timing scan;            // scanning until the device was found
+        Timing connect;         // establishing the connection
+        Timing discover;        // discovering the Mobius service
+        Timing subscribe;       // resolving and subscribing to the characteristics
+        Timing write;           // writing a request
+        Timing confirm;         // from writing a request until its response arrived
+        uint16_t scanRetries;       // scans which failed to start
+        uint16_t connectRetries;    // connection attempts after the first
+        uint16_t discoverRetries;   // service discoveries after the first
+        uint16_t connectFailures;   // connects which failed altogether
+        uint16_t profileChanges;    // connection profiles applied
+        uint32_t requestsSent;
+        uint32_t requestsSuccessful;
+        uint32_t requestsFailed;    // including timed out requests
+        uint32_t timeouts;
+        uint32_t crcErrors;
+        uint32_t cacheHits;         // reads answered and sets skipped by the attribute cache
+        uint32_t notifications;     // unsolicited updates received
+        uint32_t breakerRejections; // requests and connects refused by the open circuit breaker
+        uint32_t bytesSent;         // request bytes written
+        uint32_t bytesReceived;     // response bytes received
+        uint64_t sleepMicros;       // slept while waiting, see idle()
+        unsigned long sinceMillis;  // when collecting started
+
+        /*!
+         * @return the percentage of the time since collecting started
+         * the MCU was awake (100 if it never slept)
+         */
+        uint8_t dutyCycle() const;
+    };
+
+    /*!
+     * Unsigned integer of the PIN number for the red LED.
+     */
+    static uint16_t redLed;
+    /*!
+     * Unsigned integer of the PIN number for the blue LED.
+     */
+    static uint16_t blueLed;
+    /*!
+     * Unsigned integer of the PIN number for the green LED.
+     */
+    static uint16_t greenLed;
+    /*!
+     * Unsigned integer of the value to turn ON a LED.
+     */
+    static uint16_t ledOn;
+    /*!
+     * Unsigned integer of the value to turn OFF a LED.
+     */
+    static uint16_t ledOff;
+    /*!
+     * Boolean determining whether to log all trace events to "Serial" while
+     * no MobiusTrace sink is set. Slows requests down considerably.
+     */
+    static bool debug;
+    /*!
+     * Unsigned long of the longest milliseconds to wait for a response before
+     * a request fails, shorter once the device's round trip time is known.
+     */
+    static unsigned long responseTimeout;
+    /*!
+     * Unsigned long of the milliseconds between reconnect attempts of a session.
+     */
+    static unsigned long reconnectInterval;
+    /*!
+     * Unsigned long of the idle milliseconds after which a session sends a
+     * keep-alive request, 0 disables keep-alive requests.
+     */
+    static unsigned long keepAliveInterval;
+    /*!
+     * Unsigned long of the milliseconds to scan for a device before connecting fails.
+     */
+    static unsigned long scanTimeout;
+    /*!
+     * Unsigned long of the milliseconds a device is assumed to still be advertising
+     * after it was last seen, within which connecting skips the scan.
+     */
+    static unsigned long lastSeenTimeout;
+    /*!
+     * Boolean determining whether responses with an invalid CRC are rejected.
+     */
+    static bool verifyCrc;
+    /*!
+     * Boolean determining whether responses carry their CRC high byte
+     * first, unlike requests (which carry it low byte first).
+     */
+    static bool responseCrcSwapped;
+    /*!
+     * Unsigned long of the milliseconds a device's cached attribute values
+     * (current scene, operation state) stay valid, 0 disables the cache.
+     */
+    static unsigned long attributeCacheTimeout;
+    /*!
+     * Connection profile applied while requests are being sent.
+     */
+    static ConnectionProfile burstProfile;
+    /*!
+     * Connection profile applied once a connection is idle.
+     */
+    static ConnectionProfile idleProfile;
+    /*!
+     * Unsigned long of the milliseconds without requests after which a
+     * connection switches to the 'idleProfile', 0 leaves the connection
+     * parameters to ArduinoBLE.
+     */
+    static unsigned long idleProfileTimeout;
+
+    /*!
+     * @brief Scan for BLEDevices
+     * 
+     * Performs a scan for nearby BLEDevices which have a name of "MOBIUS".
+     * Any found devices will have their corresponding addresses added to the
+     * give 'addressBuffer' (of 'bufferSize' entries). Scanning continues
+     * while each round of 1 second finds new devices, for up to 3 rounds.
+     * Uses the MobiusScanner, which is left running if it already was.
+     * 
+     * @return number of found devices (number of addresses added)
+     */
+    static uint8_t scanForMobiusDevices(MobiusAddress addressBuffer[], uint8_t bufferSize = MOBIUS_SCANNER_SIZE);
+
+    /*!
+     * @brief Scan for BLEDevices
+     * 
+     * Same as above, adding the addresses as text ("aa:bb:cc:dd:ee:ff").
+     * 
+     * @return number of found devices (number of addresses added)
+     */
+    static uint8_t scanForMobiusDevices(String addressBuffer[], uint8_t bufferSize = MOBIUS_SCANNER_SIZE);
+
+    /*!
+     * @brief List the known Mobius devices
+     *
+     * Adds the addresses of the devices in the MobiusCache (of devices
+     * connected before, possibly before a reset when the cache is
+     * persisted) to the given 'addressBuffer' (of 'bufferSize' entries),
+     * the most recently connected first. Takes no time, so requests can
+     * be sent to known devices straight after starting up instead of
+     * waiting for scanForMobiusDevices().
+     *
+     * @return number of known devices (number of addresses added)
+     */
+    static uint8_t knownMobiusDevices(MobiusAddress addressBuffer[], uint8_t bufferSize = MOBIUS_CACHE_SIZE);
+
+    /*!
+     * @brief Sleep until the next interrupt.
+     *
+     * Lets the MCU sleep until a BLE (or any other) interrupt or the next
+     * timer tick wakes it, about a millisecond at most. All waits of the
+     * library sleep this way, unless MOBIUS_DISABLE_SLEEP is defined.
+     *
+     * @return the microseconds slept
+     */
+    static unsigned long idle();
+
+#ifndef MOBIUS_DISABLE_LEDS
+    /*!
+     * @brief Update the status LEDs.
+     *
+     * Advances the current LED pattern without blocking. Called internally
+     * while scanning, connecting and polling, it may also be called from the
+     * main loop to keep patterns blinking between library calls.
+     */
+    static void updateIndicators();
+
+    /*!
+     * @brief Show an LED pattern.
+     *
+     * Replaces the current LED pattern with the given 'indicator'. A blinking
+     * pattern stops after 'blinks' blinks (500 ms each), or continues until
+     * replaced if 'blinks' is 0.
+     */
+    static void indicate(Indicator indicator, uint8_t blinks = 0);
+#else
+    // LED support compiled out, see MOBIUS_DISABLE_LEDS
+    static void updateIndicators() { }
+    static void indicate(Indicator /*indicator*/, uint8_t /*blinks*/ = 0) { }
+#endif
+
+
+    /*!
+     * Default constructor.
+     */
+    MobiusDevice();
+    
+    /*!
+     * Constructs a new MobiusDevice which has the given address.
+     */
+    MobiusDevice(const MobiusAddress& address);
+
+    /*!
+     * Constructs a new MobiusDevice which has the given address ("aa:bb:cc:dd:ee:ff").
+     */
+    MobiusDevice(String address);
+    
+    /*!
+     * De-construct the class.
+     */
+    ~MobiusDevice();
+
+    /*!
+     * @brief Connect to the device.
+     * 
+     * Connect to the device corresponding to the current address and
+     * verify it has the required BLE characteristics.
+     * Does nothing if the device is already connected.
+     * 
+     * @return true only if successfully connected
+     */
+    bool connect();
+    
+    /*!
+     * @brief Disconnect from the device.
+     *
+     * Disconnect from the currently connected device, leaving the connections
+     * of other devices up. An active session will reconnect on the next poll()
+     * or request.
+     *
+     * @return true if no longer connected
+     */
+    bool disconnect();
+
+    /*!
+     * @return true if the device is connected with the required characteristics
+     */
+    bool connected();
+
+    /*!
+     * @brief Begin a persistent session.
+     *
+     * Connect to the device and keep the connection up between requests.
+     * While the session is active poll() notices lost connections, sends
+     * keep-alive requests when idle and reconnects every 'reconnectInterval'.
+     * Requests sent while disconnected reconnect first.
+     *
+     * @return true if the device is now connected
+     */
+    bool beginSession();
+
+    /*!
+     * @brief End the persistent session.
+     *
+     * Stop keeping the connection up and disconnect from the device.
+     */
+    void endSession();
+
+    /*!
+     * @brief Get the currently running scene.
+     * 
+     * Query the device to determine the currently running scene,
+     * unless it is cached (see attributeCacheTimeout).
+     * 
+     * @return an unsigned short
+     */
+    uint16_t getCurrentScene();
+
+    /*!
+     * @brief Set a new scene.
+     * 
+     * Sends a set scene request with the given 'sceneId' and verify
+     * the response indicates a successful set action. Nothing is sent
+     * if the cached current scene already is 'sceneId'.
+     * 
+     * @return true if the 'set' was successful
+     */
+    bool setScene(uint16_t sceneId);
+
+    /*!
+     * @brief Set the default feed scene.
+     * 
+     * Sends a set scene request with the default feed scene ID and 
+     * verify the response indicates a successful set action.
+     * 
+     * @return true if the 'set' was successful
+     */
+    bool setFeedScene();
+
+    /*!
+     * @brief Run the schedule.
+     * 
+     * Sends a request to set the device into the schedule operational
+     * state and verify the response indicates a successful action.
+     * Nothing is sent if the cached operation state already is the schedule.
+     * 
+     * @return true if the action was successful
+     */
+    bool runSchedule();
+
+    /*!
+     * @brief Begin getting the currently running scene.
+     *
+     * Sends a get scene request without waiting for the response. Up to
+     * MOBIUS_MAX_IN_FLIGHT requests may be waiting for responses. The given
+     * 'handler' is called from poll() once the response has arrived or the
+     * request has timed out. Use sceneFromData() to read the scene ID.
+     *
+     * @return true if the request was sent
+     */
+    bool beginGetCurrentScene(RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Begin setting a new scene.
+     *
+     * Sends a set scene request with the given 'sceneId' without waiting
+     * for the response. The given 'handler' is called from poll() once the
+     * response has been verified or the request has timed out.
+     *
+     * @return true if the request was sent
+     */
+    bool beginSetScene(uint16_t sceneId, RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Begin setting the default feed scene.
+     *
+     * Sends a set scene request with the default feed scene ID without
+     * waiting for the response.
+     *
+     * @return true if the request was sent
+     */
+    bool beginSetFeedScene(RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Begin running the schedule.
+     *
+     * Sends a request to set the device into the schedule operational
+     * state without waiting for the response.
+     *
+     * @return true if the request was sent
+     */
+    bool beginRunSchedule(RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Get several attributes with one request.
+     *
+     * Sends the "get" records of the given 'batch' as a single request and
+     * copies the data portion of the response into the given 'buffer' (of
+     * size 'bufferSize'). Use MobiusBatch::value() to read each attribute.
+     *
+     * @return the data's total size, 0 if the request failed
+     */
+    uint16_t getBatch(const MobiusBatch& batch, uint8_t* buffer, uint16_t bufferSize);
+
+    /*!
+     * @brief Set several attributes with one request.
+     *
+     * Sends the "set" records of the given 'batch' as a single request and
+     * verify the response indicates a successful set action.
+     *
+     * @return true if the 'set' was successful
+     */
+    bool setBatch(const MobiusBatch& batch);
+
+    /*!
+     * @brief Get an attribute.
+     *
+     * Query the device for the value of the attribute described by
+     * 'Attribute' (a MobiusAttribute, e.g. Mobius::CurrentScene) and
+     * decode it into the given 'value'.
+     *
+     * @return true if the value was received
+     */
+    template <class Attribute>
+    bool getAttribute(typename Attribute::Type& value);
+
+    /*!
+     * @brief Set an attribute.
+     *
+     * Sends a request setting the attribute described by 'Attribute' (a
+     * MobiusAttribute, e.g. Mobius::OperationState) to the given 'value'
+     * and verify the response indicates a successful set action.
+     *
+     * @return true if the 'set' was successful
+     */
+    template <class Attribute>
+    bool setAttribute(typename Attribute::Type value);
+
+    /*!
+     * @brief Begin a batched request.
+     *
+     * Sends the records of the given 'batch' as a single "get" or "set"
+     * request without waiting for the response. The given 'handler' is
+     * called from poll() once the response has arrived or the request
+     * has timed out.
+     *
+     * @return true if the request was sent
+     */
+    bool beginBatch(const MobiusBatch& batch, RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Prepare setting a new scene.
+     *
+     * Builds the set scene request with the given 'sceneId' into the given
+     * 'prepared' request, to be sent later by beginPrepared(). With an
+     * 'idleProfileTimeout' the 'burstProfile' is applied straight away,
+     * so it is in effect by the time the request is sent.
+     *
+     * @return true if the request was prepared
+     */
+    bool prepareSetScene(uint16_t sceneId, PreparedRequest& prepared);
+
+    /*!
+     * @brief Begin a prepared request.
+     *
+     * Sends the given 'prepared' request without waiting for the response.
+     * The given 'handler' is called from poll() once the response has been
+     * verified or the request has timed out. A request is sent once, or not
+     * at all if it was prepared before the device (re)connected.
+     *
+     * @return true if the request was sent
+     */
+    bool beginPrepared(PreparedRequest& prepared, RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Process BLE events for the device.
+     *
+     * Polls the BLE stack, completes a request whose response has arrived
+     * and fails a request which has exceeded the 'responseTimeout'.
+     * Should be called from the main loop while a request is pending,
+     * or continuously while a session is active.
+     *
+     * @return true if a request is still pending
+     */
+    bool poll();
+
+    /*!
+     * @return true if a request has been sent and is waiting for a response
+     */
+    bool requestPending();
+
+    /*!
+     * @return number of requests sent and waiting for a response
+     */
+    uint8_t requestsPending();
+
+    /*!
+     * @return true if the last completed request was successful
+     */
+    bool lastRequestSuccessful();
+
+    /*!
+     * @return the address of the device as text ("aa:bb:cc:dd:ee:ff")
+     */
+    String address();
+
+    /*!
+     * @return the address of the device
+     */
+    const MobiusAddress& deviceAddress() const;
+
+    /*!
+     * @return the timings and counters collected since construction or resetStats()
+     */
+    const Stats& stats();
+
+    /*!
+     * @brief Clear the collected timings and counters.
+     */
+    void resetStats();
+
+    /*!
+     * @brief Carry frames over the given 'transport'.
+     *
+     * Replaces the ArduinoBLE characteristics with the given 'transport'
+     * (e.g. a MobiusSimulator), null restores them. Should be set while
+     * disconnected.
+     */
+    void setTransport(MobiusTransport* transport);
+
+    /*!
+     * @brief Change the parameters of the connection.
+     *
+     * Asks the BLE controller to update the connection to the given
+     * 'profile'. With an 'idleProfileTimeout' the 'burstProfile' and
+     * 'idleProfile' are applied automatically around requests instead.
+     *
+     * @return true if the update was requested
+     */
+    bool setConnectionProfile(const ConnectionProfile& profile);
+
+    /*!
+     * @return the device's round trip estimate, response timeout and circuit breaker
+     */
+    MobiusRetryPolicy& retryPolicy();
+
+    /*!
+     * @return the cached current scene, or 0xFFFF if not cached (or expired)
+     */
+    uint16_t cachedScene();
+
+    /*!
+     * @return the cached operation state, or 0xFF if not cached (or expired)
+     */
+    uint8_t cachedOperationState();
+
+    /*!
+     * @brief Forget the cached attribute values.
+     *
+     * Call when the device may have been changed by someone else
+     * (e.g. the Mobius app), the next reads query the device again.
+     */
+    void invalidateCache();
+
+    /*!
+     * @brief Subscribe to changes of an attribute.
+     *
+     * Call the given 'handler' from poll() whenever the device reports on
+     * its own (e.g. when its schedule changes the scene) a new value of the
+     * attribute with the given 'attributeId'. Replaces the handler of an
+     * existing subscription to the attribute.
+     *
+     * @return true if subscribed, false if MOBIUS_MAX_SUBSCRIPTIONS are in use
+     */
+    bool subscribe(uint16_t attributeId, AttributeHandler handler);
+
+    /*!
+     * @brief Unsubscribe from changes of an attribute.
+     */
+    void unsubscribe(uint16_t attributeId);
+
+    /*!
+     * Extract the scene ID from the 'data' of a get scene response.
+     *
+     * @return the scene ID, or 0xFFFF if the data is too short
+     */
+    static uint16_t sceneFromData(MobiusSpan data);
+
+
+private:
+    friend class MobiusTransport;
+    friend class MobiusReplay;
+    friend class MobiusFleet;
+
+    /*!
+     * @brief ArduinoBLE state of a connection.
+     *
+     * Pooled so only connected (or connecting) devices hold the BLE objects.
+     */
+    struct Connection {
+        MobiusDevice* device;           // owner, null if the slot is free
+        BLEDevice peripheral;
+        BLECharacteristic request;      // TX_FINAL
+        BLECharacteristic data;         // RX_DATA
+        BLECharacteristic response;     // RX_FINAL
+    };
+    Connection* _connection = nullptr;
+    MobiusFrameAssembler* _assembler = nullptr;
+    uint16_t _messageId;
+    MobiusAddress _address;
+
+    /*!
+     * @brief A request waiting for its response.
+     */
+    struct InFlight {
+        uint16_t messageId;
+        uint8_t opCode;
+        bool keepAlive;
+        RequestHandler handler;
+        unsigned long sentMillis;
+        unsigned long sentMicros;
+        unsigned long timeoutMillis;
+        // attribute set by a "set" request (0 if unknown) and its value, for the cache
+        uint16_t setAttributeId;
+        uint16_t setValue;
+    };
+    // requests waiting for a response, oldest first
+    InFlight _inFlight[MOBIUS_MAX_IN_FLIGHT];
+    uint8_t _inFlightCount = 0;
+    bool _lastSuccessful = false;
+    // request a blocking call (or the fleet) waits for, and its result
+    uint16_t _waitMessageId = 0;
+    bool _waitSuccessful = false;
+    /*!
+     * @brief Cached value of an attribute.
+     */
+    struct CachedAttribute {
+        uint16_t value;
+        unsigned long storedMillis;
+        bool valid;
+    };
+    CachedAttribute _cachedScene = { };
+    CachedAttribute _cachedState = { };
+    // handlers of attribute changes reported by the device
+    struct Subscription {
+        uint16_t attributeId;
+        AttributeHandler handler;
+    };
+    Subscription _subscriptions[MOBIUS_MAX_SUBSCRIPTIONS] = { };
+    // attribute being written by the request under construction
+    uint16_t _setAttributeId = 0;
+    uint16_t _setValue = 0;
+    // a fragment of the response being received was lost
+    bool _fragmentDropped = false;
+    // caller buffer receiving the data of a getData() response
+    uint8_t* _dataBuffer = nullptr;
+    uint16_t _dataBufferSize = 0;
+    uint16_t _dataSize = 0;
+    bool _session = false;
+    unsigned long _activityMillis = 0;
+    unsigned long _reconnectMillis = 0;
+    /*!
+     * Connection profiles a connection may be in.
+     */
+    enum Profile : uint8_t {
+        PROFILE_DEFAULT,    // as connected by ArduinoBLE
+        PROFILE_BURST,
+        PROFILE_IDLE,
+        PROFILE_CUSTOM      // set by setConnectionProfile()
+    };
+    Profile _profile = PROFILE_DEFAULT;
+    // the burst profile was requested on an idle connection, no response has arrived since
+    bool _profileUpdating = false;
+    // when the last request was sent or completed
+    unsigned long _profileMillis = 0;
+    MobiusTransport* _transport = nullptr;
+    MobiusRetryPolicy _policy;
+    Stats _stats;
+
+    /*!
+     * Connections of the connected devices, also used to route BLE events.
+     */
+    static Connection _connections[MOBIUS_MAX_CONNECTIONS];
+
+    /*!
+     * Buffer for building requests, which are written one at a time.
+     */
+    static uint8_t _frame[MOBIUS_MAX_REQUEST_SIZE];
+    static MobiusFrameWriter _writer;
+
+    /*!
+     * Assemblers receiving responses, each used by one device until its response is complete.
+     */
+    static MobiusFrameAssembler _assemblers[MOBIUS_MAX_ASSEMBLERS];
+    static MobiusDevice* _assemblerOwners[MOBIUS_MAX_ASSEMBLERS];
+
+#ifndef MOBIUS_DISABLE_LEDS
+    static Indicator _indicator;
+    static uint8_t _indicatorBlinks;
+    static bool _indicatorLit;
+    static unsigned long _indicatorMillis;
+
+    /*!
+     * Turn the LEDs used by the given 'indicator' on or off, all other LEDs are turned off.
+     */
+    static void lightIndicator(Indicator indicator, bool lit);
+
+    /*!
+     * Turn off the LEDs if the given 'indicator' is still being shown.
+     */
+    static void clearIndicator(Indicator indicator);
+#else
+    static void clearIndicator(Indicator /*indicator*/) { }
+#endif
+
+    /*!
+     * Wait for 'ms' milliseconds while keeping the BLE stack and LEDs updated.
+     */
+    static void pause(unsigned long ms);
+
+    /*!
+     * Sleep until the next event (see idle()) while waiting for the device,
+     * counting the time slept. Transports are polled, so they never sleep.
+     */
+    void waitForEvent();
+
+    /*!
+     * Apply the given connection 'profile' (one of the static profiles).
+     *
+     * @return true if the update was requested
+     */
+    bool applyProfile(Profile profile);
+
+    /*!
+     * Switch an idle connection to the 'idleProfile' after the 'idleProfileTimeout'.
+     */
+    void maintainProfile();
+
+
+    /*!
+     * Attempt to connect to a Mobius device with the given address.
+     * A device seen within the 'lastSeenTimeout' (by a device or the
+     * MobiusScanner) is connected without scanning, otherwise the scan stops
+     * as soon as the device is found or 'scanTimeout' passes.
+     * A background scan is paused while connecting.
+     *
+     * @return a connected BLEDevice if successful, otherwise a neutral BLEDevice
+     */
+    bool connectTo(const MobiusAddress& address);
+
+    /*!
+     * Attempt to connect to a Mobius device with the given address, see connectTo().
+     *
+     * @return true if connected
+     */
+    bool connectToAddress(const MobiusAddress& address);
+
+    /*!
+     * Scan for the Mobius device with the given address (for up to 'scanTimeout').
+     *
+     * @return the found BLEDevice, otherwise a neutral BLEDevice
+     */
+    BLEDevice scanFor(const MobiusAddress& address);
+
+    /*!
+     * @brief Connect to BLEDevice
+     * 
+     * Connect to the given 'peripheral' and check for characteristics.
+     * Multiple attempts may be made to both connect and discover characteristics.
+     *
+     * @return whether the BLEDevice is currently connected
+     */
+    bool connectTo(BLEDevice& peripheral);
+
+    /*!
+     * @brief Connect to relevant characteristics
+     * 
+     * Connect to the relevant characteristics on the given 'peripheral' for sending
+     * and receiving messages.
+     * - REQUEST_CHARACTERISTIC must be found and writable
+     * - RESPONSE_CHARACTERISTIC_1 must be found and subscribed to
+     * - RESPONSE_CHARACTERISTIC_2 must be found and subscribed to
+     *
+     * @return true only if all the required characteristics are connected/ready
+     */
+    bool connectToCharacteristics(BLEDevice& peripheral);
+
+    /*!
+     * Claim a pooled connection for this device, which then receives the
+     * BLE events of its peripheral.
+     *
+     * @return true if the device holds a connection, false if all MOBIUS_MAX_CONNECTIONS are in use
+     */
+    bool claimConnection();
+
+    /*!
+     * Return the device's connection (if any) to the pool.
+     */
+    void releaseConnection();
+
+    /*!
+     * @return true if any MobiusDevice holds a connection
+     */
+    static bool anyConnected();
+
+    /*!
+     * @brief Disconnected event handler.
+     *
+     * Called by ArduinoBLE when a connection is lost, releases the
+     * MobiusDevice connected to the 'peripheral'.
+     */
+    static void onDisconnected(BLEDevice peripheral);
+
+    /*!
+     * Release the connection state after the link has been lost.
+     */
+    void connectionLost();
+
+    /*!
+     * Keep an active session's connection up, reconnecting or sending a
+     * keep-alive request when needed.
+     */
+    void maintainSession();
+
+    /*!
+     * @brief Response characteristic event handler.
+     *
+     * Called by ArduinoBLE when RESPONSE_CHARACTERISTIC_2 (RX_FINAL) is updated,
+     * forwards the response to the MobiusDevice connected to the 'peripheral'.
+     */
+    static void onResponseUpdated(BLEDevice peripheral, BLECharacteristic characteristic);
+
+    /*!
+     * @brief Data characteristic event handler.
+     *
+     * Called by ArduinoBLE when RESPONSE_CHARACTERISTIC_1 (RX_DATA) is updated,
+     * forwards the fragment to the MobiusDevice connected to the 'peripheral'.
+     */
+    static void onDataUpdated(BLEDevice peripheral, BLECharacteristic characteristic);
+
+    /*!
+     * @return the device's assembler, claiming a free one if needed (null if none are free)
+     */
+    MobiusFrameAssembler* claimAssembler();
+
+    /*!
+     * Return the device's assembler (if any) to the free assemblers.
+     */
+    void releaseAssembler();
+
+    /*!
+     * Append the value of the given 'characteristic' to the response being
+     * received, capturing it as a fragment of the given 'type' (even if it can't
+     * be stored).
+     *
+     * @return false if the fragment couldn't be stored
+     */
+    bool receiveFragment(BLECharacteristic& characteristic, MobiusCapture::Type type);
+
+    /*!
+     * Append the given 'fragment' (of size 'length') to the response being
+     * received, capturing it as a fragment of the given 'type' (even if it can't
+     * be stored).
+     *
+     * @return false if the fragment couldn't be stored
+     */
+    bool receiveFragment(const uint8_t* fragment, uint16_t length, MobiusCapture::Type type);
+
+    /*!
+     * Start writing a request with the given 'opCode' and 'reserved' value
+     * carrying 'length' bytes of data, which the caller writes into the
+     * returned writer before calling beginRequest().
+     *
+     * @return the writer of the shared request frame
+     */
+    MobiusFrameWriter& startRequest(uint8_t opCode, uint16_t reserved, uint16_t length);
+
+    /*!
+     * Send the request written since startRequest() without waiting for the
+     * response. The 'handler' is called when the request completes.
+     * Sets the value in the given 'messageId' address (if any) to the request's message ID.
+     *
+     * @return true if the request was sent
+     */
+    bool beginRequest(RequestHandler handler, uint16_t* messageId = nullptr);
+
+    /*!
+     * @return true if another request may be sent
+     */
+    bool canBegin();
+
+    /*!
+     * Send the given request 'frame' (of size 'frameSize') setting the attribute
+     * with the given 'setAttributeId' (if any) to 'setValue', see beginRequest().
+     *
+     * @return true if the request was sent
+     */
+    bool beginFrame(const uint8_t* frame, uint16_t frameSize, uint16_t setAttributeId, uint16_t setValue,
+        RequestHandler handler, uint16_t* messageId);
+
+    /*!
+     * Start a request getting the current scene.
+     */
+    void startGetCurrentScene();
+
+    /*!
+     * Start a request setting the scene with the given 'sceneId'.
+     */
+    void startSetScene(uint16_t sceneId);
+
+    /*!
+     * Start a request setting the schedule operational state.
+     */
+    void startRunSchedule();
+
+    /*!
+     * Start a request carrying the records of the given 'batch'.
+     */
+    void startBatch(const MobiusBatch& batch);
+
+    /*!
+     * @return true if the given 'attribute' holds a value within the 'attributeCacheTimeout'
+     */
+    bool cacheValid(const CachedAttribute& attribute);
+
+    /*!
+     * Cache the given 'value' of the attribute with the given 'attributeId',
+     * forgetting values which may have changed along with it.
+     */
+    void cacheAttribute(uint16_t attributeId, uint16_t value);
+
+    /*!
+     * Update the cache after the given completed 'request' with the
+     * given response 'data' (if 'successful').
+     */
+    void updateCache(const InFlight& request, bool successful, MobiusSpan data);
+
+    /*!
+     * Cache the attribute values in the given "get" response 'data'.
+     */
+    void cacheValues(MobiusSpan data);
+
+    /*!
+     * Handle the given unsolicited 'response', updating the cache and
+     * calling the subscribed handlers of the attributes it carries.
+     */
+    void notificationReceived(MobiusSpan response);
+
+    /*!
+     * @return index of the in flight request with the given 'messageId', or -1 if unknown
+     */
+    int8_t findInFlight(uint16_t messageId);
+
+    /*!
+     * Read an RX_DATA fragment of the response being received.
+     */
+    void receiveData();
+
+    /*!
+     * Note whether an RX_DATA fragment was 'stored', a dropped fragment
+     * fails the response once it is complete.
+     */
+    void dataReceived(bool stored);
+
+    /*!
+     * Read the final part of a response from the response characteristic and
+     * complete the request with the response's message ID.
+     */
+    void receiveResponse();
+
+    /*!
+     * Complete the request with the message ID of the response, whose final
+     * part has been received ('stored' tells whether it could be kept).
+     */
+    void responseReceived(bool stored);
+
+    /*!
+     * Complete the in flight request at the given 'index' with the given 'response',
+     * an empty response indicates a failure/timeout.
+     */
+    void finishRequest(uint8_t index, MobiusSpan response);
+
+    /*!
+     * Fail all in flight requests.
+     */
+    void failRequests();
+
+    /*!
+     * Wait for the request with the given 'messageId' to complete.
+     *
+     * @return true if the request was successful
+     */
+    bool waitForRequest(uint16_t messageId);
+
+    /*!
+     * Request handler copying the response data into the getData() buffer.
+     */
+    static void storeData(MobiusDevice& device, bool successful, MobiusSpan data);
+    
+    
+    /*!
+     * Send the "set" request written since startRequest().
+     *
+     * @return true if verification was requested and the response was valid,
+     * or if verification was skipped
+     */
+    bool setData(bool doVerification = true);
+
+    /*!
+     * Send the "get" request written since startRequest() and copy the
+     * data portion of the response into the given 'buffer' (of size 'bufferSize').
+     *
+     * @return the data's total size, 0 if the request failed
+     */
+    uint16_t getData(uint8_t* buffer, uint16_t bufferSize);
+
+    /*!
+     * Writes the given 'request' (of size 'length') to the request characteristic.
+     * The response is delivered to receiveResponse().
+     * 
+     * @return true if the request was written
+     */
+    bool sendRequest(const uint8_t* request, uint16_t length);
+
+    /*!
+     * Parse the response to get extract the data.
+     * 
+     * @return a view of the data within the 'response', empty if the response is invalid
+     */
+    MobiusSpan parseResponseData(MobiusSpan response);
+
+    /*!
+     * Validate the given 'response' for the request with the given 'opCode' and 'messageId'.
+     *
+     * @return true only if the response is a success message for the request
+     */
+    bool responseSuccessful(uint8_t opCode, uint16_t messageId, MobiusSpan response);
+};
+
+/*!
+ * @brief Get an attribute.
+ *
+ * Query the device for the value of the attribute described by
+ * 'Attribute' (a MobiusAttribute, e.g. Mobius::CurrentScene) and
+ * decode it into the given 'value'.
+ *
+ * @return true if the value was received
+ */
+template <class Attribute>
+bool MobiusDevice::getAttribute(typename Attribute::Type& value) {
+    Attribute::writeGet(startRequest(Mobius::OP_CODE_GET, 0x0000, Attribute::GET_SIZE));
+    // status byte followed by the attribute's record
+    uint8_t body[1 + Attribute::SET_SIZE];
+    uint16_t bodySize = getData(body, sizeof body);
+    return Attribute::read(MobiusSpan(body, bodySize), value);
+}
+/*!
+ * @brief Set an attribute.
+ *
+ * Sends a request setting the attribute described by 'Attribute' (a
+ * MobiusAttribute, e.g. Mobius::OperationState) to the given 'value'
+ * and verify the response indicates a successful set action.
+ *
+ * @return true if the 'set' was successful
+ */
+template <class Attribute>
+bool MobiusDevice::setAttribute(typename Attribute::Type value) {
+    Attribute::writeSet(startRequest(Mobius::OP_CODE_SET, 0x0800, Attribute::SET_SIZE), value);
+    _setAttributeId = Attribute::ID;
+    _setValue = value;
+    return setData();
+}
+
+#endif
@@ -0,0 +1,330 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include "MobiusFleet.h"
+
+/*!
+ * Default constructor.
+ */
+MobiusFleet::MobiusFleet() : _devices(), _size(0), _sent(), _messageIds(), _prepared(), _skew() { }
+
+/*!
+ * @brief Add a device to the fleet.
+ *
+ * The fleet keeps a reference to the given 'device', which must stay
+ * valid while it is part of the fleet.
+ *
+ * @return true if the device was added (or already part of the fleet)
+ */
+bool MobiusFleet::add(MobiusDevice& device) {
+    for (uint8_t i = 0; i < _size; i++) {
+        if (&device == _devices[i]) {
+            return true;
+        }
+    }
+    if (MOBIUS_MAX_CONNECTIONS <= _size) {
+        return false;
+    }
+    _sent[_size] = false;
+    _messageIds[_size] = 0;
+    _prepared[_size].size = 0;
+    _skew[_size] = 0;
+    _devices[_size++] = &device;
+    return true;
+}
+/*!
+ * @brief Remove a device from the fleet.
+ *
+ * The device's connection is left as it is.
+ *
+ * @return true if the device was part of the fleet
+ */
+bool MobiusFleet::remove(MobiusDevice& device) {
+    for (uint8_t i = 0; i < _size; i++) {
+        if (&device == _devices[i]) {
+            // keep the remaining devices in order
+            for (uint8_t j = i + 1; j < _size; j++) {
+                _devices[j - 1] = _devices[j];
+                _sent[j - 1] = _sent[j];
+                _messageIds[j - 1] = _messageIds[j];
+                _prepared[j - 1] = _prepared[j];
+                _skew[j - 1] = _skew[j];
+            }
+            _size--;
+            return true;
+        }
+    }
+    return false;
+}
+/*!
+ * @return number of devices in the fleet
+ */
+uint8_t MobiusFleet::size() {
+    return _size;
+}
+/*!
+ * @return a pointer to the device at the given 'index', or null if out of range
+ */
+MobiusDevice* MobiusFleet::device(uint8_t index) {
+    return (index < _size) ? _devices[index] : nullptr;
+}
+/*!
+ * @brief Connect to all devices.
+ *
+ * Connect to every device which is not already connected.
+ *
+ * @return number of connected devices
+ */
+uint8_t MobiusFleet::connect() {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < _size; i++) {
+        // ArduinoBLE connects one device at a time
+        if (_devices[i]->connect()) {
+            count++;
+        }
+    }
+    return count;
+}
+/*!
+ * @brief Disconnect from all devices.
+ */
+void MobiusFleet::disconnect() {
+    for (uint8_t i = 0; i < _size; i++) {
+        _devices[i]->disconnect();
+    }
+}
+/*!
+ * @brief Begin a persistent session on all devices.
+ *
+ * @return number of connected devices
+ */
+uint8_t MobiusFleet::beginSession() {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < _size; i++) {
+        if (_devices[i]->beginSession()) {
+            count++;
+        }
+    }
+    return count;
+}
+/*!
+ * @brief End the persistent session on all devices.
+ */
+void MobiusFleet::endSession() {
+    for (uint8_t i = 0; i < _size; i++) {
+        _devices[i]->endSession();
+    }
+}
+/*!
+ * @brief Process BLE events for all devices.
+ *
+ * @return true if a request is still pending on any device
+ */
+bool MobiusFleet::poll() {
+    bool pending = false;
+    for (uint8_t i = 0; i < _size; i++) {
+        // poll every device, even once one is known to be pending
+        pending = _devices[i]->poll() || pending;
+    }
+    return pending;
+}
+/*!
+ * @return true if a request is still pending on any device
+ */
+bool MobiusFleet::requestPending() {
+    for (uint8_t i = 0; i < _size; i++) {
+        if (_devices[i]->requestPending()) {
+            return true;
+        }
+    }
+    return false;
+}
+/*!
+ * @brief Begin setting a new scene on all devices.
+ *
+ * Sends a set scene request with the given 'sceneId' to every connected
+ * device without waiting for the responses. The 'handler' is called from
+ * poll() once for each device.
+ *
+ * @return number of devices the request was sent to
+ */
+uint8_t MobiusFleet::beginSetScene(uint16_t sceneId, MobiusDevice::RequestHandler handler) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < _size; i++) {
+        // as MobiusDevice::beginSetScene(), keeping the message ID
+        uint16_t messageId = 0;
+        _devices[i]->startSetScene(sceneId);
+        track(i, _devices[i]->beginRequest(handler, &messageId), messageId);
+        count += _sent[i];
+    }
+    return count;
+}
+/*!
+ * @brief Begin setting the default feed scene on all devices.
+ *
+ * @return number of devices the request was sent to
+ */
+uint8_t MobiusFleet::beginSetFeedScene(MobiusDevice::RequestHandler handler) {
+    return beginSetScene(Mobius::FEED_SCENE_ID, handler);
+}
+/*!
+ * @brief Begin running the schedule on all devices.
+ *
+ * @return number of devices the request was sent to
+ */
+uint8_t MobiusFleet::beginRunSchedule(MobiusDevice::RequestHandler handler) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < _size; i++) {
+        // as MobiusDevice::beginRunSchedule(), keeping the message ID
+        uint16_t messageId = 0;
+        _devices[i]->startRunSchedule();
+        track(i, _devices[i]->beginRequest(handler, &messageId), messageId);
+        count += _sent[i];
+    }
+    return count;
+}
+/*!
+ * @brief Set a new scene on all devices.
+ *
+ * Sends a set scene request with the given 'sceneId' to every connected
+ * device and waits for all the responses.
+ *
+ * @return number of devices which successfully set the scene
+ */
+uint8_t MobiusFleet::setScene(uint16_t sceneId) {
+    beginSetScene(sceneId);
+    return waitForRequests();
+}
+/*!
+ * @brief Set the default feed scene on all devices.
+ *
+ * @return number of devices which successfully set the scene
+ */
+uint8_t MobiusFleet::setFeedScene() {
+    return setScene(Mobius::FEED_SCENE_ID);
+}
+/*!
+ * @brief Run the schedule on all devices.
+ *
+ * @return number of devices successfully running the schedule
+ */
+uint8_t MobiusFleet::runSchedule() {
+    beginRunSchedule();
+    return waitForRequests();
+}
+/*!
+ * @brief Prepare setting a new scene on all devices.
+ *
+ * Connects every device which isn't connected yet and builds each
+ * device's set scene request with the given 'sceneId' ahead of time,
+ * so commit() only has to write them. Replaces the prepared requests.
+ *
+ * @return number of devices prepared
+ */
+uint8_t MobiusFleet::prepareSetScene(uint16_t sceneId) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < _size; i++) {
+        MobiusDevice* device = _devices[i];
+        _prepared[i].size = 0;
+        if ((device->connected() || device->connect()) && device->prepareSetScene(sceneId, _prepared[i])) {
+            count++;
+        }
+    }
+    return count;
+}
+/*!
+ * @brief Prepare setting the default feed scene on all devices.
+ *
+ * @return number of devices prepared
+ */
+uint8_t MobiusFleet::prepareSetFeedScene() {
+    return prepareSetScene(Mobius::FEED_SCENE_ID);
+}
+/*!
+ * @brief Begin committing the prepared requests.
+ *
+ * Writes the prepared requests to their devices back to back without
+ * waiting for the responses, measuring when each write started (see
+ * skew()). The 'handler' is called from poll() once for each device.
+ *
+ * @return number of devices the request was sent to
+ */
+uint8_t MobiusFleet::beginCommit(MobiusDevice::RequestHandler handler) {
+    uint8_t count = 0;
+    unsigned long firstMicros = micros();
+    for (uint8_t i = 0; i < _size; i++) {
+        // nothing but the writes happens between the first and the last
+        unsigned long startMicros = micros();
+        // the message ID was taken when the request was prepared
+        uint16_t messageId = _prepared[i].frame[3] | (_prepared[i].frame[4] << 8);
+        track(i, _devices[i]->beginPrepared(_prepared[i], handler), messageId);
+        _skew[i] = _sent[i] ? startMicros - firstMicros : 0;
+        count += _sent[i];
+    }
+    return count;
+}
+/*!
+ * @brief Commit the prepared requests.
+ *
+ * Writes the prepared requests to their devices back to back and
+ * waits for all the responses.
+ *
+ * @return number of devices which successfully set the scene
+ */
+uint8_t MobiusFleet::commit() {
+    beginCommit();
+    return waitForRequests();
+}
+/*!
+ * @return microseconds from the start of the last commit to the write to the
+ * device at the given 'index', 0 if it wasn't sent
+ */
+unsigned long MobiusFleet::skew(uint8_t index) {
+    return (index < _size) ? _skew[index] : 0;
+}
+/*!
+ * @return the largest skew() of the last commit
+ */
+unsigned long MobiusFleet::maxSkew() {
+    unsigned long skew = 0;
+    for (uint8_t i = 0; i < _size; i++) {
+        skew = (_skew[i] > skew) ? _skew[i] : skew;
+    }
+    return skew;
+}
+/*!
+ * Track the fleet request sent (if 'sent') to the device at the given
+ * 'index' with the given 'messageId', so its own result is counted.
+ */
+void MobiusFleet::track(uint8_t index, bool sent, uint16_t messageId) {
+    MobiusDevice* device = _devices[index];
+    _sent[index] = sent;
+    _messageIds[index] = sent ? messageId : 0;
+    if (sent) {
+        // the device records the result of this request, not of other requests in flight
+        device->_waitMessageId = messageId;
+        device->_waitSuccessful = false;
+    }
+}
+/*!
+ * Wait for the current fleet request to complete on all devices.
+ *
+ * @return number of devices where the request was successful
+ */
+uint8_t MobiusFleet::waitForRequests() {
+    while (poll()) {
+        MobiusDevice::idle();
+    }
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < _size; i++) {
+        MobiusDevice* device = _devices[i];
+        // unless a blocking call on the device waited for its own request meanwhile
+        if (_sent[i] && _messageIds[i] == device->_waitMessageId) {
+            count += device->_waitSuccessful;
+            device->_waitMessageId = 0;
+        }
+        _sent[i] = false;
+    }
+    return count;
+}
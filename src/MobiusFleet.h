@@ -0,0 +1,216 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusFleet_h
+#define _MobiusFleet_h
+
+#include "MobiusDevice.h"
+
+/*!
+ * @brief Class representing a group of Mobius devices.
+ *
+ * This class keeps up to MOBIUS_MAX_CONNECTIONS Mobius devices connected at
+ * the same time and sends requests to all of them at once. Each fleet request
+ * is written to every device before waiting for any response, so a fleet wide
+ * change takes about one device's round trip.
+ */
+class MobiusFleet {
+public:
+    /*!
+     * Default constructor.
+     */
+    MobiusFleet();
+
+    /*!
+     * @brief Add a device to the fleet.
+     *
+     * The fleet keeps a reference to the given 'device', which must stay
+     * valid while it is part of the fleet.
+     *
+     * @return true if the device was added (or already part of the fleet)
+     */
+    bool add(MobiusDevice& device);
+
+    /*!
+     * @brief Remove a device from the fleet.
+     *
+     * The device's connection is left as it is.
+     *
+     * @return true if the device was part of the fleet
+     */
+    bool remove(MobiusDevice& device);
+
+    /*!
+     * @return number of devices in the fleet
+     */
+    uint8_t size();
+
+    /*!
+     * @return a pointer to the device at the given 'index', or null if out of range
+     */
+    MobiusDevice* device(uint8_t index);
+
+    /*!
+     * @brief Connect to all devices.
+     *
+     * Connect to every device which is not already connected.
+     *
+     * @return number of connected devices
+     */
+    uint8_t connect();
+
+    /*!
+     * @brief Disconnect from all devices.
+     */
+    void disconnect();
+
+    /*!
+     * @brief Begin a persistent session on all devices.
+     *
+     * @return number of connected devices
+     */
+    uint8_t beginSession();
+
+    /*!
+     * @brief End the persistent session on all devices.
+     */
+    void endSession();
+
+    /*!
+     * @brief Process BLE events for all devices.
+     *
+     * @return true if a request is still pending on any device
+     */
+    bool poll();
+
+    /*!
+     * @return true if a request is still pending on any device
+     */
+    bool requestPending();
+
+    /*!
+     * @brief Begin setting a new scene on all devices.
+     *
+     * Sends a set scene request with the given 'sceneId' to every connected
+     * device without waiting for the responses. The 'handler' is called from
+     * poll() once for each device.
+     *
+     * @return number of devices the request was sent to
+     */
+    uint8_t beginSetScene(uint16_t sceneId, MobiusDevice::RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Begin setting the default feed scene on all devices.
+     *
+     * @return number of devices the request was sent to
+     */
+    uint8_t beginSetFeedScene(MobiusDevice::RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Begin running the schedule on all devices.
+     *
+     * @return number of devices the request was sent to
+     */
+    uint8_t beginRunSchedule(MobiusDevice::RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Set a new scene on all devices.
+     *
+     * Sends a set scene request with the given 'sceneId' to every connected
+     * device and waits for all the responses.
+     *
+     * @return number of devices which successfully set the scene
+     */
+    uint8_t setScene(uint16_t sceneId);
+
+    /*!
+     * @brief Set the default feed scene on all devices.
+     *
+     * @return number of devices which successfully set the scene
+     */
+    uint8_t setFeedScene();
+
+    /*!
+     * @brief Run the schedule on all devices.
+     *
+     * @return number of devices successfully running the schedule
+     */
+    uint8_t runSchedule();
+
+    /*!
+     * @brief Prepare setting a new scene on all devices.
+     *
+     * Connects every device which isn't connected yet and builds each
+     * device's set scene request with the given 'sceneId' ahead of time,
+     * so commit() only has to write them. Replaces the prepared requests.
+     *
+     * @return number of devices prepared
+     */
+    uint8_t prepareSetScene(uint16_t sceneId);
+
+    /*!
+     * @brief Prepare setting the default feed scene on all devices.
+     *
+     * @return number of devices prepared
+     */
+    uint8_t prepareSetFeedScene();
+
+    /*!
+     * @brief Begin committing the prepared requests.
+     *
+     * Writes the prepared requests to their devices back to back without
+     * waiting for the responses, measuring when each write started (see
+     * skew()). The 'handler' is called from poll() once for each device.
+     *
+     * @return number of devices the request was sent to
+     */
+    uint8_t beginCommit(MobiusDevice::RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Commit the prepared requests.
+     *
+     * Writes the prepared requests to their devices back to back and
+     * waits for all the responses.
+     *
+     * @return number of devices which successfully set the scene
+     */
+    uint8_t commit();
+
+    /*!
+     * @return microseconds from the start of the last commit to the write to the
+     * device at the given 'index', 0 if it wasn't sent
+     */
+    unsigned long skew(uint8_t index);
+
+    /*!
+     * @return the largest skew() of the last commit
+     */
+    unsigned long maxSkew();
+
+private:
+    MobiusDevice* _devices[MOBIUS_MAX_CONNECTIONS];
+    uint8_t _size;
+    // devices sent the current fleet request, and the message ID each one sent it with
+    bool _sent[MOBIUS_MAX_CONNECTIONS];
+    uint16_t _messageIds[MOBIUS_MAX_CONNECTIONS];
+    // requests built by the last prepare, sent by the next commit
+    MobiusDevice::PreparedRequest _prepared[MOBIUS_MAX_CONNECTIONS];
+    // start of each device's write of the last commit, after the first
+    unsigned long _skew[MOBIUS_MAX_CONNECTIONS];
+
+    /*!
+     * Track the fleet request sent (if 'sent') to the device at the given
+     * 'index' with the given 'messageId', so its own result is counted.
+     */
+    void track(uint8_t index, bool sent, uint16_t messageId);
+
+    /*!
+     * Wait for the current fleet request to complete on all devices.
+     *
+     * @return number of devices where the request was successful
+     */
+    uint8_t waitForRequests();
+};
+
+#endif
@@ -0,0 +1,209 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include <Arduino.h>
+#include <string.h>
+#include "MobiusFrame.h"
+
+/*!
+ * Constructs an empty assembler.
+ */
+MobiusFrameAssembler::MobiusFrameAssembler() {
+    reset();
+}
+/*!
+ * @brief Start a new frame.
+ *
+ * Discards any collected fragments.
+ */
+void MobiusFrameAssembler::reset() {
+    _size = 0;
+    _overflowed = false;
+    _crc.init();
+    _crcIndex = 1;
+}
+/*!
+ * @brief Add a fragment.
+ *
+ * Appends the given 'fragment' (of size 'length') to the frame. A frame
+ * growing beyond MOBIUS_MAX_RESPONSE_SIZE is marked as overflowed and
+ * the remaining bytes are dropped.
+ *
+ * @return false if the frame has overflowed
+ */
+bool MobiusFrameAssembler::append(const uint8_t* fragment, uint16_t length) {
+    uint16_t count = (length < remaining()) ? length : remaining();
+    memcpy(tail(), fragment, count);
+    _overflowed = _overflowed || (count < length);
+    return appended(count);
+}
+/*!
+ * @return a pointer to where the next fragment would be appended
+ */
+uint8_t* MobiusFrameAssembler::tail() {
+    return &_buffer[_size];
+}
+/*!
+ * @return number of bytes which may still be appended
+ */
+uint16_t MobiusFrameAssembler::remaining() {
+    return sizeof _buffer - _size;
+}
+/*!
+ * Records that 'length' bytes were written directly into tail().
+ *
+ * @return false if the frame has overflowed
+ */
+bool MobiusFrameAssembler::appended(uint16_t length) {
+    if (length > remaining()) {
+        length = remaining();
+        _overflowed = true;
+    }
+    _size += length;
+    updateCrc();
+    return !_overflowed;
+}
+/*!
+ * @return a view of the collected frame
+ */
+MobiusSpan MobiusFrameAssembler::frame() {
+    return MobiusSpan(_buffer, _size);
+}
+/*!
+ * @return true if a fragment didn't fit the buffer
+ */
+bool MobiusFrameAssembler::overflowed() {
+    return _overflowed;
+}
+/*!
+ * @brief Check the frame's CRC.
+ *
+ * The CRC covers every byte except the first one and the last two,
+ * which hold the CRC itself, little endian like on requests unless
+ * 'swapped' (high byte first).
+ *
+ * @return true if the collected frame is complete and its CRC matches
+ */
+bool MobiusFrameAssembler::crcValid(bool swapped) {
+    if (_overflowed || 3 > _size) {
+        return false;
+    }
+    uint8_t low = _buffer[_size - (swapped ? 1 : 2)];
+    uint8_t high = _buffer[_size - (swapped ? 2 : 1)];
+    return (uint16_t)(low | (high << 8)) == _crc.final();
+}
+/*!
+ * @return the CRC computed over the frame, excluding its last 2 bytes
+ */
+uint16_t MobiusFrameAssembler::crc() {
+    return _crc.final();
+}
+/*!
+ * Continue the CRC over the bytes which can no longer be the trailing CRC.
+ */
+void MobiusFrameAssembler::updateCrc() {
+    // the last 2 bytes received so far may turn out to be the CRC
+    if (_size >= 2 && _size - 2 > _crcIndex) {
+        _crc.update(&_buffer[_crcIndex], _size - 2 - _crcIndex);
+        _crcIndex = _size - 2;
+    }
+}
+/*!
+ * Constructs a writer of frames into the given 'buffer' (of size 'capacity').
+ */
+MobiusFrameWriter::MobiusFrameWriter(uint8_t* buffer, uint16_t capacity)
+    : _buffer(buffer), _capacity(capacity), _size(0), _end(0), _failed(true) {
+}
+/*!
+ * @brief Start a new frame.
+ *
+ * Writes the header of a frame with the given 'opGroup', 'opCode',
+ * 'messageId' and 'reserved' value, announcing 'length' bytes of data.
+ *
+ * @return false if the frame won't fit the buffer
+ */
+bool MobiusFrameWriter::begin(uint8_t opGroup, uint8_t opCode, uint16_t messageId, uint16_t reserved, uint16_t length) {
+    _size = 0;
+    _end = 0;
+    _failed = (length + 11 > _capacity);
+    if (_failed) {
+        return false;
+    }
+    _end = length + 11;
+    // first byte is always 02 and not part of the CRC
+    _buffer[_size++] = 0x02;
+    _crc.init();
+    uint8_t header[] = {
+        opGroup,
+        opCode,
+        lowByte(messageId), highByte(messageId), // little endian
+        highByte(reserved), lowByte(reserved),
+        lowByte(length), highByte(length)        // little endian
+    };
+    put(header, sizeof header);
+    return true;
+}
+/*!
+ * Writes the given 'data' (of size 'length') into the frame's data.
+ *
+ * @return false if the data exceeds the announced length
+ */
+bool MobiusFrameWriter::write(const uint8_t* data, uint16_t length) {
+    _failed = _failed || (_size + length > _end - 2);
+    if (!_failed) {
+        put(data, length);
+    }
+    return !_failed;
+}
+/*!
+ * Writes the given 'value' into the frame's data (little endian).
+ *
+ * @return false if the value exceeds the announced length
+ */
+bool MobiusFrameWriter::write16(uint16_t value) {
+    uint8_t bytes[] = { lowByte(value), highByte(value) };
+    return write(bytes, sizeof bytes);
+}
+/*!
+ * @brief Complete the frame.
+ *
+ * Writes the CRC once all announced data has been written.
+ *
+ * @return the frame's size, 0 if the frame is incomplete or didn't fit
+ */
+uint16_t MobiusFrameWriter::finish() {
+    if (_failed || _size != _end - 2) {
+        return 0;
+    }
+    uint16_t crc = _crc.final();
+    _buffer[_size++] = lowByte(crc); // little endian
+    _buffer[_size++] = highByte(crc);// little endian
+    return _size;
+}
+/*!
+ * @return the op code of the frame being written
+ */
+uint8_t MobiusFrameWriter::opCode() {
+    return (3 <= _size) ? _buffer[2] : 0;
+}
+/*!
+ * @return the message ID of the frame being written
+ */
+uint16_t MobiusFrameWriter::messageId() {
+    return (5 <= _size) ? (_buffer[3] | (_buffer[4] << 8)) : 0;
+}
+/*!
+ * @return a view of the frame written so far
+ */
+MobiusSpan MobiusFrameWriter::frame() {
+    return MobiusSpan(_buffer, _size);
+}
+/*!
+ * Writes the given 'data' (of size 'length') into the frame, updating the CRC.
+ */
+void MobiusFrameWriter::put(const uint8_t* data, uint16_t length) {
+    memcpy(&_buffer[_size], data, length);
+    _crc.update(&_buffer[_size], length);
+    _size += length;
+}
@@ -0,0 +1,186 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusFrame_h
+#define _MobiusFrame_h
+
+#include <cstdint>
+#include "MobiusSpan.h"
+#include "MobiusCRC.h"
+
+#ifndef MOBIUS_MAX_RESPONSE_SIZE
+/*!
+ * Size of the largest response frame which may be received.
+ */
+#define MOBIUS_MAX_RESPONSE_SIZE 255
+#endif
+
+/*!
+ * @brief Mobius class for reassembling fragmented frames.
+ *
+ * Responses larger than a single notification are sent by the device as
+ * RX_DATA (RESPONSE_CHARACTERISTIC_1) fragments followed by the final part on
+ * RX_FINAL (RESPONSE_CHARACTERISTIC_2). This class collects the fragments of
+ * one frame into a fixed buffer and updates the frame's CRC as they arrive.
+ */
+class MobiusFrameAssembler {
+public:
+    /*!
+     * Constructs an empty assembler.
+     */
+    MobiusFrameAssembler();
+
+    /*!
+     * @brief Start a new frame.
+     *
+     * Discards any collected fragments.
+     */
+    void reset();
+
+    /*!
+     * @brief Add a fragment.
+     *
+     * Appends the given 'fragment' (of size 'length') to the frame. A frame
+     * growing beyond MOBIUS_MAX_RESPONSE_SIZE is marked as overflowed and
+     * the remaining bytes are dropped.
+     *
+     * @return false if the frame has overflowed
+     */
+    bool append(const uint8_t* fragment, uint16_t length);
+
+    /*!
+     * @return a pointer to where the next fragment would be appended
+     */
+    uint8_t* tail();
+
+    /*!
+     * @return number of bytes which may still be appended
+     */
+    uint16_t remaining();
+
+    /*!
+     * Records that 'length' bytes were written directly into tail().
+     *
+     * @return false if the frame has overflowed
+     */
+    bool appended(uint16_t length);
+
+    /*!
+     * @return a view of the collected frame
+     */
+    MobiusSpan frame();
+
+    /*!
+     * @return true if a fragment didn't fit the buffer
+     */
+    bool overflowed();
+
+    /*!
+     * @brief Check the frame's CRC.
+     *
+     * The CRC covers every byte except the first one and the last two,
+     * which hold the CRC itself, little endian like on requests unless
+     * 'swapped' (high byte first).
+     *
+     * @return true if the collected frame is complete and its CRC matches
+     */
+    bool crcValid(bool swapped = false);
+
+    /*!
+     * @return the CRC computed over the frame, excluding its last 2 bytes
+     */
+    uint16_t crc();
+
+private:
+    uint8_t _buffer[MOBIUS_MAX_RESPONSE_SIZE];
+    uint16_t _size;
+    bool _overflowed;
+    // CRC of the bytes from index 1 up to (not including) _crcIndex
+    MobiusCRC _crc;
+    uint16_t _crcIndex;
+
+    /*!
+     * Continue the CRC over the bytes which can no longer be the trailing CRC.
+     */
+    void updateCrc();
+};
+
+/*!
+ * @brief Mobius class for writing request frames.
+ *
+ * This class serializes a frame's header, data and CRC into a buffer in a
+ * single pass. The data size is given up front, so the CRC is updated as
+ * each part is written and no part is copied or revisited afterwards.
+ */
+class MobiusFrameWriter {
+public:
+    /*!
+     * Constructs a writer of frames into the given 'buffer' (of size 'capacity').
+     */
+    MobiusFrameWriter(uint8_t* buffer, uint16_t capacity);
+
+    /*!
+     * @brief Start a new frame.
+     *
+     * Writes the header of a frame with the given 'opGroup', 'opCode',
+     * 'messageId' and 'reserved' value, announcing 'length' bytes of data.
+     *
+     * @return false if the frame won't fit the buffer
+     */
+    bool begin(uint8_t opGroup, uint8_t opCode, uint16_t messageId, uint16_t reserved, uint16_t length);
+
+    /*!
+     * Writes the given 'data' (of size 'length') into the frame's data.
+     *
+     * @return false if the data exceeds the announced length
+     */
+    bool write(const uint8_t* data, uint16_t length);
+
+    /*!
+     * Writes the given 'value' into the frame's data (little endian).
+     *
+     * @return false if the value exceeds the announced length
+     */
+    bool write16(uint16_t value);
+
+    /*!
+     * @brief Complete the frame.
+     *
+     * Writes the CRC once all announced data has been written.
+     *
+     * @return the frame's size, 0 if the frame is incomplete or didn't fit
+     */
+    uint16_t finish();
+
+    /*!
+     * @return the op code of the frame being written
+     */
+    uint8_t opCode();
+
+    /*!
+     * @return the message ID of the frame being written
+     */
+    uint16_t messageId();
+
+    /*!
+     * @return a view of the frame written so far
+     */
+    MobiusSpan frame();
+
+private:
+    uint8_t* _buffer;
+    uint16_t _capacity;
+    uint16_t _size;
+    // size of the frame once the announced data and the CRC are written
+    uint16_t _end;
+    bool _failed;
+    MobiusCRC _crc;
+
+    /*!
+     * Writes the given 'data' (of size 'length') into the frame, updating the CRC.
+     */
+    void put(const uint8_t* data, uint16_t length);
+};
+
+#endif
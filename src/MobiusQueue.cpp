@@ -0,0 +1,198 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include "MobiusQueue.h"
+
+/*!
+ * Constructs a queue sending the commands to the given 'device',
+ * which must stay valid while the queue is used.
+ */
+MobiusQueue::MobiusQueue(MobiusDevice& device) : _device(device) {
+}
+/*!
+ * @brief Queue setting a new scene.
+ *
+ * Replaces any queued scene change or schedule run. The given 'handler'
+ * is called from poll() once the request has completed, a replaced
+ * command's handler is called straight away as unsuccessful.
+ *
+ * @return true if the command was queued
+ */
+bool MobiusQueue::setScene(uint16_t sceneId, Priority priority, MobiusDevice::RequestHandler handler) {
+    return add(COMMAND_SET_SCENE, sceneId, priority, handler);
+}
+/*!
+ * @brief Queue setting the default feed scene with a high priority.
+ *
+ * @return true if the command was queued
+ */
+bool MobiusQueue::setFeedScene(MobiusDevice::RequestHandler handler) {
+    return setScene(Mobius::FEED_SCENE_ID, PRIORITY_HIGH, handler);
+}
+/*!
+ * @brief Queue running the schedule.
+ *
+ * Replaces any queued scene change or schedule run, calling its handler
+ * straight away as unsuccessful.
+ *
+ * @return true if the command was queued
+ */
+bool MobiusQueue::runSchedule(Priority priority, MobiusDevice::RequestHandler handler) {
+    return add(COMMAND_RUN_SCHEDULE, Mobius::OPERATION_STATE_SCHEDULE, priority, handler);
+}
+/*!
+ * @brief Queue getting the currently running scene.
+ *
+ * A read which is already queued is shared, so it can only have one
+ * 'handler': a read with a different handler than the queued one is
+ * rejected. Use MobiusDevice::sceneFromData() to read the scene ID in
+ * the 'handler'.
+ *
+ * @return true if the command was queued
+ */
+bool MobiusQueue::getCurrentScene(Priority priority, MobiusDevice::RequestHandler handler) {
+    return add(COMMAND_GET_SCENE, 0, priority, handler);
+}
+/*!
+ * @brief Send the next command.
+ *
+ * Polls the device and sends the highest priority command once the
+ * previous one has completed. Commands which can't be sent (e.g. while
+ * a session is reconnecting) stay queued. Should be called from the
+ * main loop instead of the device's poll().
+ *
+ * @return true if commands are queued or in flight
+ */
+bool MobiusQueue::poll() {
+    bool pending = _device.poll();
+    while (!pending && _count) {
+        // the oldest command of the highest priority goes first
+        uint8_t next = 0;
+        for (uint8_t i = 1; i < _count; i++) {
+            if (_entries[i].priority > _entries[next].priority) {
+                next = i;
+            }
+        }
+        Entry entry = _entries[next];
+        if (alreadySet(entry)) {
+            // nothing to send, complete it straight away
+            remove(next);
+            if (entry.handler) {
+                entry.handler(_device, true, MobiusSpan());
+            }
+            continue;
+        }
+        if (!send(entry)) {
+            // try again on the next poll
+            break;
+        }
+        remove(next);
+        pending = true;
+    }
+    return pending || _count;
+}
+/*!
+ * @return number of queued commands (not counting the one in flight)
+ */
+uint8_t MobiusQueue::count() {
+    return _count;
+}
+/*!
+ * @return number of commands replaced by newer ones since construction
+ */
+uint32_t MobiusQueue::superseded() {
+    return _superseded;
+}
+/*!
+ * Remove all queued commands, their handlers are not called.
+ */
+void MobiusQueue::clear() {
+    _count = 0;
+}
+/*!
+ * Queue the given 'command' with 'value', replacing a queued command of the
+ * same kind (or any write, for writes). A full queue drops its oldest
+ * command of the lowest priority if that is below the given 'priority'.
+ * The handler of a replaced write or dropped command is called as unsuccessful.
+ *
+ * @return true if the command was queued
+ */
+bool MobiusQueue::add(Command command, uint16_t value, Priority priority, MobiusDevice::RequestHandler handler) {
+    bool write = COMMAND_GET_SCENE != command;
+    for (uint8_t i = 0; i < _count; i++) {
+        Entry& entry = _entries[i];
+        bool queuedWrite = COMMAND_GET_SCENE != entry.command;
+        if (command == entry.command || (write && queuedWrite)) {
+            if (!write && handler && entry.handler && handler != entry.handler) {
+                // a shared read calls a single handler
+                return false;
+            }
+            // the latest scene or state wins, keeping the earlier place in the queue
+            MobiusDevice::RequestHandler replaced = write ? entry.handler : nullptr;
+            _superseded++;
+            entry.command = command;
+            entry.value = value;
+            entry.handler = (write || handler) ? handler : entry.handler;
+            if (priority > entry.priority) {
+                entry.priority = priority;
+            }
+            if (replaced) {
+                // its value never goes out
+                replaced(_device, false, MobiusSpan());
+            }
+            return true;
+        }
+    }
+    Entry dropped = Entry();
+    if (MOBIUS_QUEUE_SIZE <= _count) {
+        uint8_t lowest = 0;
+        for (uint8_t i = 1; i < _count; i++) {
+            if (_entries[i].priority < _entries[lowest].priority) {
+                lowest = i;
+            }
+        }
+        if (_entries[lowest].priority >= priority) {
+            return false;
+        }
+        // make room by dropping the least important command
+        dropped = _entries[lowest];
+        remove(lowest);
+    }
+    _entries[_count++] = { command, priority, value, handler };
+    if (dropped.handler) {
+        dropped.handler(_device, false, MobiusSpan());
+    }
+    return true;
+}
+/*!
+ * @return true if the device is known to already run what the given 'entry' sets
+ */
+bool MobiusQueue::alreadySet(const Entry& entry) {
+    switch (entry.command) {
+        case COMMAND_SET_SCENE:    return entry.value == _device.cachedScene();
+        case COMMAND_RUN_SCHEDULE: return entry.value == _device.cachedOperationState();
+        default:                   return false;
+    }
+}
+/*!
+ * Send the given 'entry' to the device.
+ *
+ * @return true if the request was sent
+ */
+bool MobiusQueue::send(const Entry& entry) {
+    switch (entry.command) {
+        case COMMAND_SET_SCENE:    return _device.beginSetScene(entry.value, entry.handler);
+        case COMMAND_RUN_SCHEDULE: return _device.beginRunSchedule(entry.handler);
+        default:                   return _device.beginGetCurrentScene(entry.handler);
+    }
+}
+/*!
+ * Remove the entry at the given 'index'.
+ */
+void MobiusQueue::remove(uint8_t index) {
+    _count--;
+    for (uint8_t i = index; i < _count; i++) {
+        _entries[i] = _entries[i + 1];
+    }
+}
@@ -0,0 +1,166 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusQueue_h
+#define _MobiusQueue_h
+
+#include <cstdint>
+#include "MobiusDevice.h"
+
+#ifndef MOBIUS_QUEUE_SIZE
+/*!
+ * Maximum number of commands waiting in a MobiusQueue.
+ */
+#define MOBIUS_QUEUE_SIZE 4
+#endif
+
+/*!
+ * @brief Coalescing command queue of a Mobius device.
+ *
+ * This class queues scene changes and status reads for a single device and
+ * sends them one at a time from poll(), highest priority first. A queued
+ * command superseded by a newer one (e.g. a scene change followed by another
+ * scene change or by running the schedule) is replaced, so only the latest
+ * value goes out no matter how often it changes while waiting. Commands
+ * setting what is already cached as running (see
+ * MobiusDevice::attributeCacheTimeout) complete without a request.
+ */
+class MobiusQueue {
+public:
+    /*!
+     * Priorities of queued commands, higher priorities are sent first.
+     */
+    enum Priority : uint8_t {
+        PRIORITY_LOW,       // status reads
+        PRIORITY_NORMAL,    // scene changes
+        PRIORITY_HIGH       // feeding
+    };
+
+    /*!
+     * Constructs a queue sending the commands to the given 'device',
+     * which must stay valid while the queue is used.
+     */
+    MobiusQueue(MobiusDevice& device);
+
+    /*!
+     * @brief Queue setting a new scene.
+     *
+     * Replaces any queued scene change or schedule run. The given 'handler'
+     * is called from poll() once the request has completed, a replaced
+     * command's handler is called straight away as unsuccessful.
+     *
+     * @return true if the command was queued
+     */
+    bool setScene(uint16_t sceneId, Priority priority = PRIORITY_NORMAL, MobiusDevice::RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Queue setting the default feed scene with a high priority.
+     *
+     * @return true if the command was queued
+     */
+    bool setFeedScene(MobiusDevice::RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Queue running the schedule.
+     *
+     * Replaces any queued scene change or schedule run, calling its handler
+     * straight away as unsuccessful.
+     *
+     * @return true if the command was queued
+     */
+    bool runSchedule(Priority priority = PRIORITY_NORMAL, MobiusDevice::RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Queue getting the currently running scene.
+     *
+     * A read which is already queued is shared, so it can only have one
+     * 'handler': a read with a different handler than the queued one is
+     * rejected. Use MobiusDevice::sceneFromData() to read the scene ID in
+     * the 'handler'.
+     *
+     * @return true if the command was queued
+     */
+    bool getCurrentScene(Priority priority = PRIORITY_LOW, MobiusDevice::RequestHandler handler = nullptr);
+
+    /*!
+     * @brief Send the next command.
+     *
+     * Polls the device and sends the highest priority command once the
+     * previous one has completed. Commands which can't be sent (e.g. while
+     * a session is reconnecting) stay queued. Should be called from the
+     * main loop instead of the device's poll().
+     *
+     * @return true if commands are queued or in flight
+     */
+    bool poll();
+
+    /*!
+     * @return number of queued commands (not counting the one in flight)
+     */
+    uint8_t count();
+
+    /*!
+     * @return number of commands replaced by newer ones since construction
+     */
+    uint32_t superseded();
+
+    /*!
+     * Remove all queued commands, their handlers are not called.
+     */
+    void clear();
+
+private:
+    /*!
+     * Kinds of queued commands.
+     */
+    enum Command : uint8_t {
+        COMMAND_SET_SCENE,
+        COMMAND_RUN_SCHEDULE,
+        COMMAND_GET_SCENE
+    };
+    /*!
+     * @brief A queued command.
+     */
+    struct Entry {
+        uint8_t command;
+        uint8_t priority;
+        uint16_t value;
+        MobiusDevice::RequestHandler handler;
+    };
+
+    MobiusDevice& _device;
+    // waiting commands, oldest first
+    Entry _entries[MOBIUS_QUEUE_SIZE];
+    uint8_t _count = 0;
+    uint32_t _superseded = 0;
+
+    /*!
+     * Queue the given 'command' with 'value', replacing a queued command of the
+     * same kind (or any write, for writes). A full queue drops its oldest
+     * command of the lowest priority if that is below the given 'priority'.
+     * The handler of a replaced write or dropped command is called as unsuccessful.
+     *
+     * @return true if the command was queued
+     */
+    bool add(Command command, uint16_t value, Priority priority, MobiusDevice::RequestHandler handler);
+
+    /*!
+     * @return true if the device is known to already run what the given 'entry' sets
+     */
+    bool alreadySet(const Entry& entry);
+
+    /*!
+     * Send the given 'entry' to the device.
+     *
+     * @return true if the request was sent
+     */
+    bool send(const Entry& entry);
+
+    /*!
+     * Remove the entry at the given 'index'.
+     */
+    void remove(uint8_t index);
+};
+
+#endif
@@ -0,0 +1,225 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include <Arduino.h>
+#include <string.h>
+#include "MobiusReplay.h"
+
+/*!
+ * Constructs a replay of the given captured 'log' (of size 'length'),
+ * which must stay valid while replaying.
+ */
+MobiusReplay::MobiusReplay(const uint8_t* log, uint16_t length)
+    : _log(log), _length(length), _offset(0), _device(nullptr), _recordedLatency(false),
+      _requestRecordMicros(0), _requestMicros(0), _requests(0), _mismatches(0),
+      _dataTiming(), _finalTiming() {
+}
+/*!
+ * Deliver each fragment as late after its request as it was received,
+ * reproducing timeouts, instead of straight away (the default).
+ */
+void MobiusReplay::setRecordedLatency(bool recorded) {
+    _recordedLatency = recorded;
+}
+/*!
+ * @brief Replay the session.
+ *
+ * Send each recorded request from the 'device' and poll it until the
+ * fragments received after the request have been delivered, then wait
+ * for the last responses. A request which can't be sent (e.g. with
+ * fewer requests in flight allowed than recorded) is skipped once no
+ * requests are pending.
+ *
+ * @return number of recorded requests sent
+ */
+uint16_t MobiusReplay::run(MobiusDevice& device) {
+    uint16_t sent = 0;
+    if (&device != _device) {
+        // the fragments would never be delivered
+        return sent;
+    }
+    while (!done()) {
+        if (MobiusCapture::TYPE_REQUEST != _log[_offset]) {
+            // delivers the fragments, once due
+            device.poll();
+        }
+        else if (step(device)) {
+            sent++;
+        }
+        else if (!device.poll()) {
+            // nothing pending will make room for the request, skip it
+            _offset += MobiusCapture::RECORD_HEADER_SIZE + bytes().size();
+        }
+    }
+    // complete (or time out) the last requests
+    while (device.poll()) { }
+    return sent;
+}
+/*!
+ * @brief Replay the next request.
+ *
+ * Send the recorded request at the current position from the 'device',
+ * its fragments are delivered by the following polls.
+ *
+ * @return true if a request was sent
+ */
+bool MobiusReplay::step(MobiusDevice& device) {
+    if (!skipToRecord() || MobiusCapture::TYPE_REQUEST != _log[_offset]) {
+        return false;
+    }
+    MobiusSpan request = bytes();
+    // the request goes out with its recorded message ID, matching the recorded responses
+    if (5 > request.size() || !device.canBegin()) {
+        return false;
+    }
+    return device.beginFrame(request.data(), request.size(), 0, 0, nullptr, nullptr);
+}
+/*!
+ * @return true if the whole log has been replayed
+ */
+bool MobiusReplay::done() {
+    return !skipToRecord();
+}
+/*!
+ * Start replaying from the beginning of the log again.
+ */
+void MobiusReplay::rewind() {
+    _offset = 0;
+    _requests = 0;
+    _mismatches = 0;
+    _dataTiming = MobiusDevice::Timing();
+    _finalTiming = MobiusDevice::Timing();
+}
+/*!
+ * @return number of recorded requests sent
+ */
+uint16_t MobiusReplay::requests() {
+    return _requests;
+}
+/*!
+ * @return number of requests written which didn't match the next recorded request
+ */
+uint16_t MobiusReplay::mismatches() {
+    return _mismatches;
+}
+/*!
+ * @return time the device took to handle each RX_DATA fragment (assembling and CRC)
+ */
+const MobiusDevice::Timing& MobiusReplay::dataTiming() {
+    return _dataTiming;
+}
+/*!
+ * @return time the device took to handle each RX_FINAL fragment (completing the response)
+ */
+const MobiusDevice::Timing& MobiusReplay::finalTiming() {
+    return _finalTiming;
+}
+/*!
+ * Connect the given 'device', which fragments are delivered to.
+ *
+ * @return true, the recorded device is always in range
+ */
+bool MobiusReplay::connect(MobiusDevice& device) {
+    _device = &device;
+    // fragments received before the first request are timed from the connection
+    _requestRecordMicros = (_offset + MobiusCapture::RECORD_HEADER_SIZE <= _length) ? recordMicros() : 0;
+    _requestMicros = micros();
+    return true;
+}
+/*!
+ * Disconnect the connected device.
+ */
+void MobiusReplay::disconnect() {
+    _device = nullptr;
+}
+/*!
+ * @return true if a device is connected
+ */
+bool MobiusReplay::connected() {
+    return _device;
+}
+/*!
+ * Receive the given request 'frame' (of size 'length'), which should
+ * be the next recorded request. Its fragments are delivered by poll().
+ *
+ * @return true if a device is connected
+ */
+bool MobiusReplay::write(const uint8_t* frame, uint16_t length) {
+    if (!_device) {
+        return false;
+    }
+    if (skipToRecord() && MobiusCapture::TYPE_REQUEST == _log[_offset]) {
+        MobiusSpan request = bytes();
+        if (length == request.size() && 0 == memcmp(frame, request.data(), length)) {
+            _requestRecordMicros = recordMicros();
+            _requestMicros = micros();
+            _offset += MobiusCapture::RECORD_HEADER_SIZE + length;
+            _requests++;
+            return true;
+        }
+    }
+    // not the recorded request, it will time out
+    _mismatches++;
+    return true;
+}
+/*!
+ * Deliver the recorded fragments up to the next recorded request.
+ */
+void MobiusReplay::poll() {
+    while (_device && skipToRecord() && MobiusCapture::TYPE_REQUEST != _log[_offset]) {
+        if (_recordedLatency && (recordMicros() - _requestRecordMicros) > (micros() - _requestMicros)) {
+            // not received yet
+            return;
+        }
+        uint8_t type = _log[_offset];
+        MobiusSpan fragment = bytes();
+        // move on first, the device may write the next request while handling the fragment
+        _offset += MobiusCapture::RECORD_HEADER_SIZE + fragment.size();
+        unsigned long startMicros = micros();
+        if (MobiusCapture::TYPE_DATA == type) {
+            deliverData(*_device, fragment.data(), fragment.size());
+            _dataTiming.add(micros() - startMicros);
+        }
+        else if (MobiusCapture::TYPE_FINAL == type) {
+            deliverFinal(*_device, fragment.data(), fragment.size());
+            _finalTiming.add(micros() - startMicros);
+        }
+    }
+}
+/*!
+ * Skip connect records (and a truncated last record).
+ *
+ * @return true if a record is left at the current position
+ */
+bool MobiusReplay::skipToRecord() {
+    while (_offset < _length) {
+        if (_length < _offset + MobiusCapture::RECORD_HEADER_SIZE
+                || _length < _offset + MobiusCapture::RECORD_HEADER_SIZE + bytes().size()) {
+            // truncated, nothing more to replay
+            _offset = _length;
+        }
+        else if (MobiusCapture::TYPE_CONNECT == _log[_offset]) {
+            _offset += MobiusCapture::RECORD_HEADER_SIZE + bytes().size();
+        }
+        else {
+            return true;
+        }
+    }
+    return false;
+}
+/*!
+ * @return the bytes of the record at the current position
+ */
+MobiusSpan MobiusReplay::bytes() {
+    uint16_t size = _log[_offset + 5] | (_log[_offset + 6] << 8);
+    return MobiusSpan(&_log[_offset + MobiusCapture::RECORD_HEADER_SIZE], size);
+}
+/*!
+ * @return the timestamp of the record at the current position
+ */
+uint32_t MobiusReplay::recordMicros() {
+    // little endian
+    return (uint32_t)_log[_offset + 1] | ((uint32_t)_log[_offset + 2] << 8)
+        | ((uint32_t)_log[_offset + 3] << 16) | ((uint32_t)_log[_offset + 4] << 24);
+}
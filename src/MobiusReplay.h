@@ -0,0 +1,158 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusReplay_h
+#define _MobiusReplay_h
+
+#include <cstdint>
+#include "MobiusDevice.h"
+#include "MobiusCapture.h"
+
+/*!
+ * @brief Mobius transport replaying a captured session.
+ *
+ * This class plays the device side of a session recorded by MobiusCapture
+ * (as copied by MobiusCapture::copy()), so the fragments received in the
+ * field go through the device's assembling, CRC, validation and parsing
+ * paths again, on the board or on a host. run() sends the recorded
+ * requests (with their recorded message IDs) and delivers the fragments
+ * received after each of them; the time spent handling the fragments is
+ * measured alongside the device's own stats().
+ *
+ *     MobiusReplay replay(log, logSize);
+ *     device.setTransport(&replay);
+ *     device.connect();
+ *     replay.run(device);
+ */
+class MobiusReplay : public MobiusTransport {
+public:
+    /*!
+     * Constructs a replay of the given captured 'log' (of size 'length'),
+     * which must stay valid while replaying.
+     */
+    MobiusReplay(const uint8_t* log, uint16_t length);
+
+    /*!
+     * Deliver each fragment as late after its request as it was received,
+     * reproducing timeouts, instead of straight away (the default).
+     */
+    void setRecordedLatency(bool recorded);
+
+    /*!
+     * @brief Replay the session.
+     *
+     * Send each recorded request from the 'device' and poll it until the
+     * fragments received after the request have been delivered, then wait
+     * for the last responses. A request which can't be sent (e.g. with
+     * fewer requests in flight allowed than recorded) is skipped once no
+     * requests are pending.
+     *
+     * @return number of recorded requests sent
+     */
+    uint16_t run(MobiusDevice& device);
+
+    /*!
+     * @brief Replay the next request.
+     *
+     * Send the recorded request at the current position from the 'device',
+     * its fragments are delivered by the following polls.
+     *
+     * @return true if a request was sent
+     */
+    bool step(MobiusDevice& device);
+
+    /*!
+     * @return true if the whole log has been replayed
+     */
+    bool done();
+
+    /*!
+     * Start replaying from the beginning of the log again.
+     */
+    void rewind();
+
+    /*!
+     * @return number of recorded requests sent
+     */
+    uint16_t requests();
+
+    /*!
+     * @return number of requests written which didn't match the next recorded request
+     */
+    uint16_t mismatches();
+
+    /*!
+     * @return time the device took to handle each RX_DATA fragment (assembling and CRC)
+     */
+    const MobiusDevice::Timing& dataTiming();
+
+    /*!
+     * @return time the device took to handle each RX_FINAL fragment (completing the response)
+     */
+    const MobiusDevice::Timing& finalTiming();
+
+    /*!
+     * Connect the given 'device', which fragments are delivered to.
+     *
+     * @return true, the recorded device is always in range
+     */
+    bool connect(MobiusDevice& device);
+
+    /*!
+     * Disconnect the connected device.
+     */
+    void disconnect();
+
+    /*!
+     * @return true if a device is connected
+     */
+    bool connected();
+
+    /*!
+     * Receive the given request 'frame' (of size 'length'), which should
+     * be the next recorded request. Its fragments are delivered by poll().
+     *
+     * @return true if a device is connected
+     */
+    bool write(const uint8_t* frame, uint16_t length);
+
+    /*!
+     * Deliver the recorded fragments up to the next recorded request.
+     */
+    void poll();
+
+private:
+    const uint8_t* _log;
+    uint16_t _length;
+    // offset of the next record to replay
+    uint16_t _offset;
+    MobiusDevice* _device;
+    bool _recordedLatency;
+    // when the last request was recorded and replayed
+    uint32_t _requestRecordMicros;
+    unsigned long _requestMicros;
+    uint16_t _requests;
+    uint16_t _mismatches;
+    MobiusDevice::Timing _dataTiming;
+    MobiusDevice::Timing _finalTiming;
+
+    /*!
+     * Skip connect records (and a truncated last record).
+     *
+     * @return true if a record is left at the current position
+     */
+    bool skipToRecord();
+
+    /*!
+     * @return the bytes of the record at the current position
+     */
+    MobiusSpan bytes();
+
+    /*!
+     * @return the timestamp of the record at the current position
+     */
+    uint32_t recordMicros();
+};
+
+#endif
@@ -0,0 +1,152 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include <Arduino.h>
+#include "MobiusRetryPolicy.h"
+#include "MobiusDevice.h"
+
+/*!
+ * Unsigned long of the shortest response timeout in milliseconds.
+ * Defaults to 250
+ */
+unsigned long MobiusRetryPolicy::minTimeout = 250;
+/*!
+ * Unsigned integer of the consecutive failures opening the circuit,
+ * 0 disables the circuit breaker.
+ * Defaults to 5
+ */
+uint8_t MobiusRetryPolicy::failureThreshold = 5;
+/*!
+ * Unsigned long of the milliseconds an open circuit fails fast.
+ * Defaults to 30000
+ */
+unsigned long MobiusRetryPolicy::breakerTimeout = 30000;
+/*!
+ * Unsigned long of the milliseconds before the first retry, doubling with each attempt.
+ * Defaults to 100
+ */
+unsigned long MobiusRetryPolicy::retryDelay = 100;
+
+/*!
+ * Constructs a policy without round trip samples.
+ */
+MobiusRetryPolicy::MobiusRetryPolicy() {
+    reset();
+}
+/*!
+ * Forget all samples and failures, closing the circuit.
+ */
+void MobiusRetryPolicy::reset() {
+    _srttMicros = 0;
+    _rttVarMicros = 0;
+    _backoff = 0;
+    _failures = 0;
+    _state = STATE_CLOSED;
+    _openedMillis = 0;
+}
+/*!
+ * @brief Record a response which arrived after 'rttMicros'.
+ *
+ * Updates the round trip estimate and closes the circuit.
+ */
+void MobiusRetryPolicy::success(uint32_t rttMicros) {
+    if (!_srttMicros) {
+        // the first sample
+        _srttMicros = rttMicros ? rttMicros : 1;
+        _rttVarMicros = rttMicros / 2;
+    }
+    else {
+        // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R
+        uint32_t delta = (_srttMicros > rttMicros) ? _srttMicros - rttMicros : rttMicros - _srttMicros;
+        _rttVarMicros = _rttVarMicros - _rttVarMicros / 4 + delta / 4;
+        _srttMicros = _srttMicros - _srttMicros / 8 + rttMicros / 8;
+    }
+    _backoff = 0;
+    _failures = 0;
+    _state = STATE_CLOSED;
+}
+/*!
+ * @brief Record a successful connection.
+ *
+ * Closes a half open circuit, without resetting the failures.
+ */
+void MobiusRetryPolicy::connected() {
+    if (STATE_HALF_OPEN == _state) {
+        _state = STATE_CLOSED;
+        // the next failure opens the circuit again
+        _failures = failureThreshold ? failureThreshold - 1 : 0;
+    }
+}
+/*!
+ * @brief Record a failed request or connect.
+ *
+ * A 'timedOut' request doubles the response timeout.
+ */
+void MobiusRetryPolicy::failure(bool timedOut) {
+    if (timedOut && _backoff < 8) {
+        _backoff++;
+    }
+    if (_failures < 0xFF) {
+        _failures++;
+    }
+    if (failureThreshold && (STATE_HALF_OPEN == _state || failureThreshold <= _failures)) {
+        // stop burning air time on the device for a while
+        _state = STATE_OPEN;
+        _openedMillis = millis();
+    }
+}
+/*!
+ * @return true if a request or connect may be attempted (the circuit isn't open)
+ */
+bool MobiusRetryPolicy::allow() {
+    if (STATE_OPEN == _state && breakerTimeout <= (millis() - _openedMillis)) {
+        // time for a trial
+        _state = STATE_HALF_OPEN;
+    }
+    return STATE_OPEN != _state;
+}
+/*!
+ * @return the response timeout in milliseconds
+ */
+unsigned long MobiusRetryPolicy::timeout() const {
+    unsigned long maxTimeout = MobiusDevice::responseTimeout;
+    unsigned long timeout = maxTimeout;
+    if (_srttMicros) {
+        // RTO = SRTT + 4 RTTVAR, rounded up to milliseconds
+        timeout = (_srttMicros + 4 * _rttVarMicros + 999) / 1000;
+        timeout = (minTimeout > timeout) ? minTimeout : timeout;
+        timeout <<= _backoff;
+    }
+    return (maxTimeout < timeout) ? maxTimeout : timeout;
+}
+/*!
+ * @return the delay in milliseconds before the given retry 'attempt' (starting at 0)
+ */
+unsigned long MobiusRetryPolicy::backoff(uint8_t attempt) const {
+    return retryDelay << ((8 < attempt) ? 8 : attempt);
+}
+/*!
+ * @return the smoothed round trip time in microseconds, 0 without samples
+ */
+uint32_t MobiusRetryPolicy::smoothedRttMicros() const {
+    return _srttMicros;
+}
+/*!
+ * @return the round trip time variation in microseconds
+ */
+uint32_t MobiusRetryPolicy::rttVariationMicros() const {
+    return _rttVarMicros;
+}
+/*!
+ * @return number of consecutive failures
+ */
+uint8_t MobiusRetryPolicy::failures() const {
+    return _failures;
+}
+/*!
+ * @return the state of the circuit breaker
+ */
+MobiusRetryPolicy::State MobiusRetryPolicy::state() const {
+    return _state;
+}
@@ -0,0 +1,125 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusRetryPolicy_h
+#define _MobiusRetryPolicy_h
+
+#include <cstdint>
+
+/*!
+ * @brief Adaptive timeouts, backoff and circuit breaker of a Mobius device.
+ *
+ * This class keeps a smoothed round trip time and its variation (like TCP's
+ * retransmission timeout, RFC 6298) from the device's responses and derives
+ * the response timeout from them, between 'minTimeout' and
+ * MobiusDevice::responseTimeout. Each timeout doubles the next one until a
+ * response arrives again. After 'failureThreshold' consecutive failures the
+ * circuit opens and the device fails fast for 'breakerTimeout', after which
+ * a single trial decides whether it closes again.
+ */
+class MobiusRetryPolicy {
+public:
+    /*!
+     * States of the circuit breaker.
+     */
+    enum State : uint8_t {
+        STATE_CLOSED,       // requests and connects are allowed
+        STATE_OPEN,         // failing fast
+        STATE_HALF_OPEN     // trying again, the next result opens or closes
+    };
+
+    /*!
+     * Unsigned long of the shortest response timeout in milliseconds.
+     */
+    static unsigned long minTimeout;
+    /*!
+     * Unsigned integer of the consecutive failures opening the circuit,
+     * 0 disables the circuit breaker.
+     */
+    static uint8_t failureThreshold;
+    /*!
+     * Unsigned long of the milliseconds an open circuit fails fast.
+     */
+    static unsigned long breakerTimeout;
+    /*!
+     * Unsigned long of the milliseconds before the first retry, doubling with each attempt.
+     */
+    static unsigned long retryDelay;
+
+    /*!
+     * Constructs a policy without round trip samples.
+     */
+    MobiusRetryPolicy();
+
+    /*!
+     * Forget all samples and failures, closing the circuit.
+     */
+    void reset();
+
+    /*!
+     * @brief Record a response which arrived after 'rttMicros'.
+     *
+     * Updates the round trip estimate and closes the circuit.
+     */
+    void success(uint32_t rttMicros);
+
+    /*!
+     * @brief Record a successful connection.
+     *
+     * Closes a half open circuit, without resetting the failures.
+     */
+    void connected();
+
+    /*!
+     * @brief Record a failed request or connect.
+     *
+     * A 'timedOut' request doubles the response timeout.
+     */
+    void failure(bool timedOut);
+
+    /*!
+     * @return true if a request or connect may be attempted (the circuit isn't open)
+     */
+    bool allow();
+
+    /*!
+     * @return the response timeout in milliseconds
+     */
+    unsigned long timeout() const;
+
+    /*!
+     * @return the delay in milliseconds before the given retry 'attempt' (starting at 0)
+     */
+    unsigned long backoff(uint8_t attempt) const;
+
+    /*!
+     * @return the smoothed round trip time in microseconds, 0 without samples
+     */
+    uint32_t smoothedRttMicros() const;
+
+    /*!
+     * @return the round trip time variation in microseconds
+     */
+    uint32_t rttVariationMicros() const;
+
+    /*!
+     * @return number of consecutive failures
+     */
+    uint8_t failures() const;
+
+    /*!
+     * @return the state of the circuit breaker
+     */
+    State state() const;
+
+private:
+    uint32_t _srttMicros;
+    uint32_t _rttVarMicros;
+    uint8_t _backoff;
+    uint8_t _failures;
+    State _state;
+    unsigned long _openedMillis;
+};
+
+#endif
@@ -0,0 +1,212 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include <Arduino.h>
+#include "MobiusScanner.h"
+
+/*!
+ * Devices seen while scanning, in the order they were first seen.
+ */
+MobiusScanner::Entry MobiusScanner::_entries[MOBIUS_SCANNER_SIZE];
+uint8_t MobiusScanner::_count = 0;
+bool MobiusScanner::_scanning = false;
+bool MobiusScanner::_paused = false;
+bool MobiusScanner::_begun = false;
+
+/*!
+ * @brief Start scanning in the background.
+ *
+ * Initializes BLE the first time and keeps scanning (until end()) as
+ * long as poll() is called. MobiusDevice::poll() calls it as well.
+ *
+ * @return true if scanning
+ */
+bool MobiusScanner::begin() {
+    if (!_begun) {
+        _begun = BLE.begin();
+    }
+    _paused = false;
+    _scanning = _scanning || (_begun && startScan());
+    return _scanning;
+}
+/*!
+ * @brief Stop scanning.
+ *
+ * The registry is kept.
+ */
+void MobiusScanner::end() {
+    if (_scanning && !_paused) {
+        BLE.stopScan();
+    }
+    _scanning = false;
+    _paused = false;
+}
+/*!
+ * @return true if scanning in the background
+ */
+bool MobiusScanner::scanning() {
+    return _scanning;
+}
+/*!
+ * @brief Record the advertisements received since the last poll.
+ *
+ * Should be called from the main loop while scanning.
+ */
+void MobiusScanner::poll() {
+    if (!_scanning || _paused) {
+        return;
+    }
+    for (BLEDevice device = BLE.available(); device; device = BLE.available()) {
+        record(device);
+    }
+}
+/*!
+ * Find the entry of the device with the given 'address'.
+ *
+ * @return a pointer to the entry, or null if the device hasn't been seen
+ */
+const MobiusScanner::Entry* MobiusScanner::find(const MobiusAddress& address) {
+    int8_t index = address ? indexOf(address) : -1;
+    return (0 <= index) ? &_entries[index] : nullptr;
+}
+/*!
+ * Find the entry of the device with the given 'address' ("aa:bb:cc:dd:ee:ff").
+ *
+ * @return a pointer to the entry, or null if the device hasn't been seen
+ */
+const MobiusScanner::Entry* MobiusScanner::find(const char* address) {
+    return find(MobiusAddress(address));
+}
+/*!
+ * @return the entry at the given 'index' (below count()), or null
+ */
+const MobiusScanner::Entry* MobiusScanner::entry(uint8_t index) {
+    return (index < _count) ? &_entries[index] : nullptr;
+}
+/*!
+ * @return number of devices in the registry
+ */
+uint8_t MobiusScanner::count() {
+    return _count;
+}
+/*!
+ * Remove the devices not seen within the last 'ms' milliseconds.
+ */
+void MobiusScanner::expire(unsigned long ms) {
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        if (ms >= (millis() - _entries[i].lastSeenMillis)) {
+            _entries[kept++] = _entries[i];
+        }
+    }
+    for (uint8_t i = kept; i < _count; i++) {
+        // release the advertisement
+        _entries[i].device = BLEDevice();
+    }
+    _count = kept;
+}
+/*!
+ * Remove the device with the given 'address' (e.g. no longer reachable).
+ */
+void MobiusScanner::forget(const MobiusAddress& address) {
+    int8_t index = indexOf(address);
+    if (0 > index) {
+        return;
+    }
+    // keep the remaining devices in order
+    for (uint8_t i = index + 1; i < _count; i++) {
+        _entries[i - 1] = _entries[i];
+    }
+    _count--;
+    // release the advertisement
+    _entries[_count].device = BLEDevice();
+}
+/*!
+ * Remove all devices.
+ */
+void MobiusScanner::clear() {
+    for (uint8_t i = 0; i < _count; i++) {
+        _entries[i].device = BLEDevice();
+    }
+    _count = 0;
+}
+/*!
+ * @brief Pause a background scan.
+ *
+ * Stops scanning (e.g. to connect or scan for a single address)
+ * until resume() is called.
+ *
+ * @return true if a background scan was paused
+ */
+bool MobiusScanner::pause() {
+    if (!_scanning || _paused) {
+        return false;
+    }
+    // keep what has already arrived
+    poll();
+    BLE.stopScan();
+    _paused = true;
+    return true;
+}
+/*!
+ * Resume the scan paused by pause().
+ */
+void MobiusScanner::resume() {
+    if (_scanning && _paused) {
+        _paused = false;
+        _scanning = startScan();
+    }
+}
+/*!
+ * @brief Record an advertising device.
+ *
+ * Add or update the entry of the given advertising 'device' (e.g. found
+ * by a MobiusDevice's own scan). The least recently seen entry is
+ * replaced when the registry is full.
+ */
+void MobiusScanner::record(BLEDevice& device) {
+    // ArduinoBLE only provides the address as text
+    MobiusAddress address(device.address().c_str());
+    if (!address) {
+        return;
+    }
+    int8_t index = indexOf(address);
+    if (0 > index && MOBIUS_SCANNER_SIZE > _count) {
+        index = _count++;
+    }
+    else if (0 > index) {
+        // full, replace the least recently seen device
+        index = 0;
+        for (uint8_t i = 1; i < _count; i++) {
+            if ((millis() - _entries[i].lastSeenMillis) > (millis() - _entries[index].lastSeenMillis)) {
+                index = i;
+            }
+        }
+    }
+    Entry& entry = _entries[index];
+    entry.address = address;
+    entry.rssi = device.rssi();
+    entry.lastSeenMillis = millis();
+    entry.device = device;
+}
+/*!
+ * @return index of the entry with the given 'address', or -1 if unknown
+ */
+int8_t MobiusScanner::indexOf(const MobiusAddress& address) {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_entries[i].address == address) {
+            return i;
+        }
+    }
+    return -1;
+}
+/*!
+ * Start the BLE scan for Mobius devices.
+ *
+ * @return true if the scan started
+ */
+bool MobiusScanner::startScan() {
+    // report every advertisement to keep the signal strength and last seen time fresh
+    return BLE.scanForName("MOBIUS", true);
+}
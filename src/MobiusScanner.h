@@ -0,0 +1,152 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusScanner_h
+#define _MobiusScanner_h
+
+#include <cstdint>
+#include <ArduinoBLE.h>
+#include "MobiusAddress.h"
+
+#ifndef MOBIUS_SCANNER_SIZE
+/*!
+ * Maximum number of devices kept in the MobiusScanner registry.
+ */
+#define MOBIUS_SCANNER_SIZE 8
+#endif
+
+/*!
+ * @brief Background discovery of Mobius devices.
+ *
+ * This utility class keeps scanning for advertising Mobius devices while
+ * the main loop runs, recording each device (deduplicated by address) in
+ * a fixed size registry with its signal strength and when it was last seen.
+ * MobiusDevice::connect() connects straight to a freshly seen device.
+ */
+class MobiusScanner {
+public:
+    /*!
+     * @brief Registry details of a single device.
+     */
+    struct Entry {
+        MobiusAddress address;
+        int8_t rssi;
+        unsigned long lastSeenMillis;
+        // the latest advertisement, for connecting without a scan
+        BLEDevice device;
+    };
+
+    /*!
+     * @brief Start scanning in the background.
+     *
+     * Initializes BLE the first time and keeps scanning (until end()) as
+     * long as poll() is called. MobiusDevice::poll() calls it as well.
+     *
+     * @return true if scanning
+     */
+    static bool begin();
+
+    /*!
+     * @brief Stop scanning.
+     *
+     * The registry is kept.
+     */
+    static void end();
+
+    /*!
+     * @return true if scanning in the background
+     */
+    static bool scanning();
+
+    /*!
+     * @brief Record the advertisements received since the last poll.
+     *
+     * Should be called from the main loop while scanning.
+     */
+    static void poll();
+
+    /*!
+     * Find the entry of the device with the given 'address'.
+     *
+     * @return a pointer to the entry, or null if the device hasn't been seen
+     */
+    static const Entry* find(const MobiusAddress& address);
+
+    /*!
+     * Find the entry of the device with the given 'address' ("aa:bb:cc:dd:ee:ff").
+     *
+     * @return a pointer to the entry, or null if the device hasn't been seen
+     */
+    static const Entry* find(const char* address);
+
+    /*!
+     * @return the entry at the given 'index' (below count()), or null
+     */
+    static const Entry* entry(uint8_t index);
+
+    /*!
+     * @return number of devices in the registry
+     */
+    static uint8_t count();
+
+    /*!
+     * Remove the devices not seen within the last 'ms' milliseconds.
+     */
+    static void expire(unsigned long ms);
+
+    /*!
+     * Remove all devices.
+     */
+    static void clear();
+
+    /*!
+     * @brief Pause a background scan.
+     *
+     * Stops scanning (e.g. to connect or scan for a single address)
+     * until resume() is called.
+     *
+     * @return true if a background scan was paused
+     */
+    static bool pause();
+
+    /*!
+     * Resume the scan paused by pause().
+     */
+    static void resume();
+
+    /*!
+     * @brief Record an advertising device.
+     *
+     * Add or update the entry of the given advertising 'device' (e.g. found
+     * by a MobiusDevice's own scan). The least recently seen entry is
+     * replaced when the registry is full.
+     */
+    static void record(BLEDevice& device);
+
+    /*!
+     * Remove the device with the given 'address' (e.g. no longer reachable).
+     */
+    static void forget(const MobiusAddress& address);
+
+private:
+    static Entry _entries[MOBIUS_SCANNER_SIZE];
+    static uint8_t _count;
+    static bool _scanning;
+    static bool _paused;
+    static bool _begun;
+
+    /*!
+     * @return index of the entry with the given 'address', or -1 if unknown
+     */
+    static int8_t indexOf(const MobiusAddress& address);
+
+    /*!
+     * Start the BLE scan for Mobius devices.
+     *
+     * @return true if the scan started
+     */
+    static bool startScan();
+};
+
+#endif
@@ -0,0 +1,196 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include <Arduino.h>
+#include <string.h>
+#include "MobiusSchedule.h"
+
+/*!
+ * Constructs an empty schedule stored in the given 'buffer' (of size
+ * 'capacity'), which must stay valid while the schedule is used.
+ */
+MobiusSchedule::MobiusSchedule(uint8_t* buffer, uint16_t capacity) : _buffer(buffer), _capacity(capacity) {
+    clear();
+}
+/*!
+ * @brief Remove all records.
+ *
+ * Also rewinds the transfers.
+ */
+void MobiusSchedule::clear() {
+    _size = 0;
+    _count = 0;
+    rewind();
+}
+/*!
+ * @brief Add a record.
+ *
+ * Add the attribute with the given 'attributeId' and 'value' (of size
+ * 'length') to the schedule.
+ *
+ * @return true if the record was added
+ */
+bool MobiusSchedule::add(uint16_t attributeId, const uint8_t* value, uint8_t length) {
+    // each record must fit a request frame on its own
+    if (MobiusBatch::CAPACITY < 5 + length || _capacity < _size + RECORD_HEADER_SIZE + length || 0xFF == _count) {
+        return false;
+    }
+    _buffer[_size++] = lowByte(attributeId); // little endian
+    _buffer[_size++] = highByte(attributeId);// little endian
+    _buffer[_size++] = length;
+    memcpy(&_buffer[_size], value, length);
+    _size += length;
+    _count++;
+    return true;
+}
+/*!
+ * @return a view of the value of the attribute with the given 'attributeId', empty if unknown
+ */
+MobiusSpan MobiusSchedule::value(uint16_t attributeId) const {
+    for (uint16_t offset = 0; offset < _size; offset += RECORD_HEADER_SIZE + _buffer[offset + 2]) {
+        if (attributeId == attributeIdAt(offset)) {
+            return MobiusSpan(&_buffer[offset + RECORD_HEADER_SIZE], _buffer[offset + 2]);
+        }
+    }
+    return MobiusSpan();
+}
+/*!
+ * @return number of records in the schedule
+ */
+uint8_t MobiusSchedule::count() const {
+    return _count;
+}
+/*!
+ * @return a view of the encoded records
+ */
+MobiusSpan MobiusSchedule::data() const {
+    return MobiusSpan(_buffer, _size);
+}
+/*!
+ * @brief Download a schedule.
+ *
+ * Get the attributes with the given 'attributeIds' (list of 'count'
+ * IDs) from the 'device' and add them to the schedule, connecting
+ * the device if needed. Call clear() before downloading a different
+ * list of attributes. Each response is received into the free part of
+ * the buffer, which must hold the largest chunk's response.
+ *
+ * @return true if all attributes were downloaded, call again to resume otherwise
+ */
+bool MobiusSchedule::download(MobiusDevice& device, const uint16_t* attributeIds, uint8_t count) {
+    if (!device.connected() && !device.connect()) {
+        return false;
+    }
+    while (_downloaded < count) {
+        // request as many attributes as fit a request frame
+        MobiusBatch batch;
+        uint8_t last = _downloaded;
+        while (last < count && batch.get(attributeIds[last])) {
+            last++;
+        }
+        if (0xFF < _count + (last - _downloaded)) {
+            return false;
+        }
+        // receive into the free part of the buffer instead of a buffer on the stack
+        uint16_t end = _size + device.getBatch(batch, &_buffer[_size], _capacity - _size);
+        // compact the records in place, skipping the status byte
+        uint16_t read = _size + 1;
+        uint16_t written = _size;
+        for (uint8_t i = _downloaded; i < last; i++) {
+            if (end < read + 5 || end < read + 5 + _buffer[read + 4]) {
+                // failed or truncated, the chunk is requested again when resuming
+                return false;
+            }
+            uint16_t attributeId = _buffer[read] | (_buffer[read + 1] << 8);
+            uint8_t length = _buffer[read + 4];
+            if (attributeIds[i] != attributeId || !length || MobiusBatch::CAPACITY < 5 + length) {
+                return false;
+            }
+            // the compact record is shorter, so it never overtakes the record being read
+            _buffer[written] = lowByte(attributeId); // little endian
+            _buffer[written + 1] = highByte(attributeId);// little endian
+            _buffer[written + 2] = length;
+            memmove(&_buffer[written + RECORD_HEADER_SIZE], &_buffer[read + 5], length);
+            written += RECORD_HEADER_SIZE + length;
+            read += 5 + length;
+        }
+        _size = written;
+        _count += last - _downloaded;
+        _downloaded = last;
+    }
+    return true;
+}
+/*!
+ * @brief Upload the schedule.
+ *
+ * Set all attributes of the schedule on the 'device', connecting the
+ * device if needed. Call rewind() before uploading to another device.
+ *
+ * @return true if all records were uploaded, call again to resume otherwise
+ */
+bool MobiusSchedule::upload(MobiusDevice& device) {
+    if (_uploaded < _size && !device.connected() && !device.connect()) {
+        return false;
+    }
+    while (_uploaded < _size) {
+        // send as many records as fit a request frame
+        MobiusBatch batch;
+        uint16_t offset = _uploaded;
+        while (offset < _size && batch.set(attributeIdAt(offset), &_buffer[offset + RECORD_HEADER_SIZE], _buffer[offset + 2])) {
+            offset += RECORD_HEADER_SIZE + _buffer[offset + 2];
+        }
+        if (!device.setBatch(batch)) {
+            return false;
+        }
+        _uploaded = offset;
+    }
+    return true;
+}
+/*!
+ * @brief Upload the schedule to a fleet.
+ *
+ * Upload the schedule to each device of the 'fleet' in turn, stopping
+ * at the first device where the upload fails.
+ *
+ * @return number of devices with the complete schedule, call again to resume
+ */
+uint8_t MobiusSchedule::upload(MobiusFleet& fleet) {
+    while (_device < fleet.size()) {
+        if (!upload(*fleet.device(_device))) {
+            return _device;
+        }
+        // continue with the next device from the first record
+        _device++;
+        _uploaded = 0;
+    }
+    return _device;
+}
+/*!
+ * @brief Restart the transfers.
+ *
+ * The next download() or upload() starts from the first record again.
+ */
+void MobiusSchedule::rewind() {
+    _downloaded = 0;
+    _uploaded = 0;
+    _device = 0;
+}
+/*!
+ * @return number of attributes downloaded
+ */
+uint8_t MobiusSchedule::downloaded() const {
+    return _downloaded;
+}
+/*!
+ * @return number of bytes of records uploaded to the current device
+ */
+uint16_t MobiusSchedule::uploaded() const {
+    return _uploaded;
+}
+/*!
+ * @return the attribute ID of the record at the given 'offset'
+ */
+uint16_t MobiusSchedule::attributeIdAt(uint16_t offset) const {
+    return _buffer[offset] | (_buffer[offset + 1] << 8);
+}
@@ -0,0 +1,164 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusSchedule_h
+#define _MobiusSchedule_h
+
+#include <cstdint>
+#include "MobiusDevice.h"
+#include "MobiusFleet.h"
+
+/*!
+ * @brief Resumable transfer of a Mobius schedule.
+ *
+ * This class holds the attributes making up a schedule (or scene
+ * definitions) in a caller provided buffer, in a compact encoding of one
+ * record per attribute: attribute ID (little endian), value size, value.
+ * A schedule is downloaded from a device with "get" requests and uploaded
+ * to devices with "set" requests, each request streaming as many records
+ * as fit one request frame (see MOBIUS_MAX_REQUEST_SIZE).
+ *
+ * The transfer remembers what has been confirmed, so after a failure or a
+ * lost connection calling download() or upload() again resumes with the
+ * first chunk which wasn't confirmed.
+ */
+class MobiusSchedule {
+public:
+    /*!
+     * Number of bytes of a record besides its value.
+     */
+    static const uint8_t RECORD_HEADER_SIZE = 3;
+
+    /*!
+     * Constructs an empty schedule stored in the given 'buffer' (of size
+     * 'capacity'), which must stay valid while the schedule is used.
+     */
+    MobiusSchedule(uint8_t* buffer, uint16_t capacity);
+
+    /*!
+     * @brief Remove all records.
+     *
+     * Also rewinds the transfers.
+     */
+    void clear();
+
+    /*!
+     * @brief Add a record.
+     *
+     * Add the attribute with the given 'attributeId' and 'value' (of size
+     * 'length') to the schedule.
+     *
+     * @return true if the record was added
+     */
+    bool add(uint16_t attributeId, const uint8_t* value, uint8_t length);
+
+    /*!
+     * @brief Add a record.
+     *
+     * Add the attribute described by 'Attribute' (a MobiusAttribute) with
+     * the given 'value' to the schedule.
+     *
+     * @return true if the record was added
+     */
+    template <class Attribute>
+    bool add(typename Attribute::Type value);
+
+    /*!
+     * @return a view of the value of the attribute with the given 'attributeId', empty if unknown
+     */
+    MobiusSpan value(uint16_t attributeId) const;
+
+    /*!
+     * @return number of records in the schedule
+     */
+    uint8_t count() const;
+
+    /*!
+     * @return a view of the encoded records
+     */
+    MobiusSpan data() const;
+
+    /*!
+     * @brief Download a schedule.
+     *
+     * Get the attributes with the given 'attributeIds' (list of 'count'
+     * IDs) from the 'device' and add them to the schedule, connecting
+     * the device if needed. Call clear() before downloading a different
+     * list of attributes. Each response is received into the free part of
+     * the buffer, which must hold the largest chunk's response.
+     *
+     * @return true if all attributes were downloaded, call again to resume otherwise
+     */
+    bool download(MobiusDevice& device, const uint16_t* attributeIds, uint8_t count);
+
+    /*!
+     * @brief Upload the schedule.
+     *
+     * Set all attributes of the schedule on the 'device', connecting the
+     * device if needed. Call rewind() before uploading to another device.
+     *
+     * @return true if all records were uploaded, call again to resume otherwise
+     */
+    bool upload(MobiusDevice& device);
+
+    /*!
+     * @brief Upload the schedule to a fleet.
+     *
+     * Upload the schedule to each device of the 'fleet' in turn, stopping
+     * at the first device where the upload fails.
+     *
+     * @return number of devices with the complete schedule, call again to resume
+     */
+    uint8_t upload(MobiusFleet& fleet);
+
+    /*!
+     * @brief Restart the transfers.
+     *
+     * The next download() or upload() starts from the first record again.
+     */
+    void rewind();
+
+    /*!
+     * @return number of attributes downloaded
+     */
+    uint8_t downloaded() const;
+
+    /*!
+     * @return number of bytes of records uploaded to the current device
+     */
+    uint16_t uploaded() const;
+
+private:
+    uint8_t* _buffer;
+    uint16_t _capacity;
+    uint16_t _size;
+    uint8_t _count;
+    // attributes confirmed by the download
+    uint8_t _downloaded;
+    // bytes of records confirmed by the upload, to the fleet's device at '_device'
+    uint16_t _uploaded;
+    uint8_t _device;
+
+    /*!
+     * @return the attribute ID of the record at the given 'offset'
+     */
+    uint16_t attributeIdAt(uint16_t offset) const;
+};
+
+/*!
+ * @brief Add a record.
+ *
+ * Add the attribute described by 'Attribute' (a MobiusAttribute) with
+ * the given 'value' to the schedule.
+ *
+ * @return true if the record was added
+ */
+template <class Attribute>
+bool MobiusSchedule::add(typename Attribute::Type value) {
+    uint8_t bytes[Attribute::SIZE];
+    Attribute::encode(value, bytes);
+    return add(Attribute::ID, bytes, Attribute::SIZE);
+}
+
+#endif
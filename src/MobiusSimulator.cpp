@@ -0,0 +1,238 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include <Arduino.h>
+#include "MobiusSimulator.h"
+#include "MobiusCRC.h"
+
+/*!
+ * Constructs a simulated device answering straight away.
+ */
+MobiusSimulator::MobiusSimulator()
+    : _pendingCount(0), _device(nullptr), _latency(0), _dropRate(0), _corruptRate(0),
+      _fragmentSize(0), _scene(0), _operationState(Mobius::OPERATION_STATE_SCHEDULE),
+      _requests(0), _responses(0), _dropped(0) {
+}
+/*!
+ * Delay each response by the given 'micros'.
+ */
+void MobiusSimulator::setLatency(unsigned long micros) {
+    _latency = micros;
+}
+/*!
+ * Drop the given 'percent' of responses at random.
+ */
+void MobiusSimulator::setDropRate(uint8_t percent) {
+    _dropRate = percent;
+}
+/*!
+ * Corrupt the given 'percent' of responses at random (breaking their CRC).
+ */
+void MobiusSimulator::setCorruptRate(uint8_t percent) {
+    _corruptRate = percent;
+}
+/*!
+ * Split responses into RX_DATA fragments of the given 'size' followed
+ * by the final RX_FINAL part, 0 sends each response on RX_FINAL only.
+ */
+void MobiusSimulator::setFragmentSize(uint8_t size) {
+    _fragmentSize = size;
+}
+/*!
+ * @return the currently running scene
+ */
+uint16_t MobiusSimulator::scene() {
+    return _scene;
+}
+/*!
+ * @brief Change the scene as the device's schedule would.
+ *
+ * Run the given 'sceneId' and push an unsolicited update of the
+ * current scene (with message ID 0) to the connected device.
+ */
+void MobiusSimulator::changeScene(uint16_t sceneId) {
+    _scene = sceneId;
+    if (!_device || MOBIUS_MAX_IN_FLIGHT <= _pendingCount) {
+        return;
+    }
+    // the update is laid out as a "get" confirm: status, then the scene's record
+    const uint8_t status = 0x00;
+    Pending& update = _pending[_pendingCount++];
+    MobiusFrameWriter writer(update.frame, sizeof update.frame);
+    writer.begin(Mobius::OP_GROUP_CONFIRM, Mobius::OP_CODE_GET, 0x0000, 0x0000, 1 + Mobius::CurrentScene::SET_SIZE);
+    writer.write(&status, 1);
+    Mobius::CurrentScene::writeSet(writer, sceneId);
+    update.size = writer.finish();
+    update.dueMicros = micros() + _latency;
+}
+/*!
+ * @return number of valid requests received
+ */
+uint32_t MobiusSimulator::requests() {
+    return _requests;
+}
+/*!
+ * @return number of responses sent (including corrupted ones)
+ */
+uint32_t MobiusSimulator::responses() {
+    return _responses;
+}
+/*!
+ * @return number of responses dropped
+ */
+uint32_t MobiusSimulator::dropped() {
+    return _dropped;
+}
+/*!
+ * Connect the given 'device', which responses are delivered to.
+ *
+ * @return true, the simulated device is always in range
+ */
+bool MobiusSimulator::connect(MobiusDevice& device) {
+    _device = &device;
+    _pendingCount = 0;
+    return true;
+}
+/*!
+ * Disconnect the connected device, discarding its pending responses.
+ */
+void MobiusSimulator::disconnect() {
+    _device = nullptr;
+    _pendingCount = 0;
+}
+/*!
+ * @return true if a device is connected
+ */
+bool MobiusSimulator::connected() {
+    return _device;
+}
+/*!
+ * Receive the given request 'frame' (of size 'length') and queue the
+ * confirm, unless it is dropped. Frames with an invalid CRC are ignored.
+ *
+ * @return true if a device is connected
+ */
+bool MobiusSimulator::write(const uint8_t* frame, uint16_t length) {
+    if (!_device) {
+        return false;
+    }
+    MobiusSpan request(frame, length);
+    uint16_t crc = MobiusCRC::crc16(&frame[1], length - 3);
+    bool valid = (11 <= length) && (0x02 == frame[0]) && (Mobius::OP_GROUP_REQUEST == frame[1])
+        && (lowByte(crc) == frame[length - 2]) && (highByte(crc) == frame[length - 1]);
+    if (!valid) {
+        // a device ignores broken requests
+        return true;
+    }
+    _requests++;
+    if (MOBIUS_MAX_IN_FLIGHT <= _pendingCount || (_dropRate > random(100))) {
+        _dropped++;
+        return true;
+    }
+    Pending& response = _pending[_pendingCount];
+    if (confirm(request, response)) {
+        response.dueMicros = micros() + _latency;
+        _pendingCount++;
+    }
+    return true;
+}
+/*!
+ * Deliver the responses whose latency has passed.
+ */
+void MobiusSimulator::poll() {
+    while (_device && _pendingCount && (long)(micros() - _pending[0].dueMicros) >= 0) {
+        // take the response off the queue first, the device may write while it is delivered
+        _delivering = _pending[0];
+        _pendingCount--;
+        for (uint8_t i = 0; i < _pendingCount; i++) {
+            _pending[i] = _pending[i + 1];
+        }
+        if (_corruptRate > random(100)) {
+            _delivering.frame[_delivering.size / 2] ^= 0x10;
+        }
+        _responses++;
+        deliver(_delivering);
+    }
+}
+/*!
+ * Write the confirm of the given 'request' into the given 'response'.
+ *
+ * @return false if the confirm doesn't fit
+ */
+bool MobiusSimulator::confirm(MobiusSpan request, Pending& response) {
+    uint8_t opCode = request[2];
+    uint16_t messageId = request[3] | (request[4] << 8);
+    MobiusSpan records = request.sub(9, request[7] | (request[8] << 8));
+    // the confirm's data, starting with a 0x00 status
+    uint8_t data[MOBIUS_MAX_RESPONSE_SIZE - 11];
+    uint16_t size = 0;
+    data[size++] = 0x00;
+    if (Mobius::OP_CODE_GET == opCode) {
+        // answer every record with its value
+        for (uint16_t offset = 0; offset + 4 <= records.size(); offset += 4) {
+            if (sizeof data < size + 9u) {
+                return false;
+            }
+            memcpy(&data[size], &records.data()[offset], 4);
+            uint8_t length = valueOf(records[offset] | (records[offset + 1] << 8), &data[size + 5]);
+            data[size + 4] = length;
+            size += 5 + length;
+        }
+    }
+    else {
+        for (uint16_t offset = 0; offset + 5 <= records.size(); offset += 5 + records[offset + 4]) {
+            apply(records[offset] | (records[offset + 1] << 8), records.sub(offset + 5, records[offset + 4]));
+        }
+        data[size++] = Mobius::RESPONSE_DATA_SUCCESSFUL[0];
+        data[size++] = Mobius::RESPONSE_DATA_SUCCESSFUL[1];
+    }
+    MobiusFrameWriter writer(response.frame, sizeof response.frame);
+    writer.begin(Mobius::OP_GROUP_CONFIRM, opCode, messageId, 0x0000, size);
+    writer.write(data, size);
+    response.size = writer.finish();
+    return response.size;
+}
+/*!
+ * Write the value of the attribute with the given 'attributeId' into 'value'.
+ *
+ * @return the value's size
+ */
+uint8_t MobiusSimulator::valueOf(uint16_t attributeId, uint8_t* value) {
+    switch (attributeId) {
+        case Mobius::ATTRIBUTE_ID_CURRENT_SCENE:
+            Mobius::CurrentScene::encode(_scene, value);
+            return Mobius::CurrentScene::SIZE;
+        case Mobius::ATTRIBUTE_ID_OPERATION_STATE:
+            Mobius::OperationState::encode(_operationState, value);
+            return Mobius::OperationState::SIZE;
+        default:
+            return 0;
+    }
+}
+/*!
+ * Set the attribute with the given 'attributeId' to the given 'value'.
+ */
+void MobiusSimulator::apply(uint16_t attributeId, MobiusSpan value) {
+    if (Mobius::CurrentScene::ID == attributeId && Mobius::CurrentScene::SIZE <= value.size()) {
+        _scene = Mobius::CurrentScene::decode(value.data());
+    }
+    else if (Mobius::OperationState::ID == attributeId && Mobius::OperationState::SIZE <= value.size()) {
+        _operationState = Mobius::OperationState::decode(value.data());
+        if (Mobius::OPERATION_STATE_SCHEDULE == _operationState) {
+            // the schedule runs its own scenes
+            _scene = 0;
+        }
+    }
+}
+/*!
+ * Hand the given 'response' to the device in fragments.
+ */
+void MobiusSimulator::deliver(const Pending& response) {
+    uint16_t offset = 0;
+    while (_fragmentSize && response.size - offset > _fragmentSize) {
+        deliverData(*_device, &response.frame[offset], _fragmentSize);
+        offset += _fragmentSize;
+    }
+    deliverFinal(*_device, &response.frame[offset], response.size - offset);
+}
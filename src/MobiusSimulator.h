@@ -0,0 +1,155 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusSimulator_h
+#define _MobiusSimulator_h
+
+#include <cstdint>
+#include "MobiusDevice.h"
+
+/*!
+ * @brief Mobius transport simulating a Mobius device.
+ *
+ * This class answers "get" and "set" requests like a Mobius device would,
+ * without a radio, so the request path can be benchmarked and exercised on
+ * any board. The scene and operation state attributes are kept; other
+ * attributes are accepted but have no value. The latency, share of dropped
+ * and corrupted responses and the RX_DATA fragment size are configurable.
+ * Holds up to MOBIUS_MAX_IN_FLIGHT responses of MOBIUS_MAX_RESPONSE_SIZE.
+ */
+class MobiusSimulator : public MobiusTransport {
+public:
+    /*!
+     * Constructs a simulated device answering straight away.
+     */
+    MobiusSimulator();
+
+    /*!
+     * Delay each response by the given 'micros'.
+     */
+    void setLatency(unsigned long micros);
+
+    /*!
+     * Drop the given 'percent' of responses at random.
+     */
+    void setDropRate(uint8_t percent);
+
+    /*!
+     * Corrupt the given 'percent' of responses at random (breaking their CRC).
+     */
+    void setCorruptRate(uint8_t percent);
+
+    /*!
+     * Split responses into RX_DATA fragments of the given 'size' followed
+     * by the final RX_FINAL part, 0 sends each response on RX_FINAL only.
+     */
+    void setFragmentSize(uint8_t size);
+
+    /*!
+     * @return the currently running scene
+     */
+    uint16_t scene();
+
+    /*!
+     * @brief Change the scene as the device's schedule would.
+     *
+     * Run the given 'sceneId' and push an unsolicited update of the
+     * current scene (with message ID 0) to the connected device.
+     */
+    void changeScene(uint16_t sceneId);
+
+    /*!
+     * @return number of valid requests received
+     */
+    uint32_t requests();
+
+    /*!
+     * @return number of responses sent (including corrupted ones)
+     */
+    uint32_t responses();
+
+    /*!
+     * @return number of responses dropped
+     */
+    uint32_t dropped();
+
+    /*!
+     * Connect the given 'device', which responses are delivered to.
+     *
+     * @return true, the simulated device is always in range
+     */
+    bool connect(MobiusDevice& device);
+
+    /*!
+     * Disconnect the connected device, discarding its pending responses.
+     */
+    void disconnect();
+
+    /*!
+     * @return true if a device is connected
+     */
+    bool connected();
+
+    /*!
+     * Receive the given request 'frame' (of size 'length') and queue the
+     * confirm, unless it is dropped. Frames with an invalid CRC are ignored.
+     *
+     * @return true if a device is connected
+     */
+    bool write(const uint8_t* frame, uint16_t length);
+
+    /*!
+     * Deliver the responses whose latency has passed.
+     */
+    void poll();
+
+private:
+    struct Pending {
+        unsigned long dueMicros;
+        uint16_t size;
+        uint8_t frame[MOBIUS_MAX_RESPONSE_SIZE];
+    };
+    // responses waiting for their latency to pass, oldest first
+    Pending _pending[MOBIUS_MAX_IN_FLIGHT];
+    uint8_t _pendingCount;
+    // response being delivered, the device may write again meanwhile
+    Pending _delivering;
+
+    MobiusDevice* _device;
+    unsigned long _latency;
+    uint8_t _dropRate;
+    uint8_t _corruptRate;
+    uint8_t _fragmentSize;
+    uint16_t _scene;
+    uint8_t _operationState;
+    uint32_t _requests;
+    uint32_t _responses;
+    uint32_t _dropped;
+
+    /*!
+     * Write the confirm of the given 'request' into the given 'response'.
+     *
+     * @return false if the confirm doesn't fit
+     */
+    bool confirm(MobiusSpan request, Pending& response);
+
+    /*!
+     * Write the value of the attribute with the given 'attributeId' into 'value'.
+     *
+     * @return the value's size
+     */
+    uint8_t valueOf(uint16_t attributeId, uint8_t* value);
+
+    /*!
+     * Set the attribute with the given 'attributeId' to the given 'value'.
+     */
+    void apply(uint16_t attributeId, MobiusSpan value);
+
+    /*!
+     * Hand the given 'response' to the device in fragments.
+     */
+    void deliver(const Pending& response);
+};
+
+#endif
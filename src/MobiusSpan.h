@@ -0,0 +1,63 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusSpan_h
+#define _MobiusSpan_h
+
+#include <cstdint>
+
+/*!
+ * @brief Read only view of a byte array.
+ *
+ * This utility class refers to bytes owned by someone else (e.g. a frame
+ * buffer) without copying them. A view is only valid as long as the bytes
+ * it refers to are.
+ */
+class MobiusSpan {
+public:
+    /*!
+     * Constructs an empty view.
+     */
+    MobiusSpan() : _data(nullptr), _size(0) { }
+
+    /*!
+     * Constructs a view of the given 'data' (of size 'size').
+     */
+    MobiusSpan(const uint8_t* data, uint16_t size) : _data(data), _size(size) { }
+
+    /*!
+     * @return a pointer to the first byte
+     */
+    const uint8_t* data() const { return _data; }
+
+    /*!
+     * @return number of bytes in the view
+     */
+    uint16_t size() const { return _size; }
+
+    /*!
+     * @return true if the view has no bytes
+     */
+    bool empty() const { return 0 == _size; }
+
+    /*!
+     * @return the byte at the given 'index' (not range checked)
+     */
+    uint8_t operator[](uint16_t index) const { return _data[index]; }
+
+    /*!
+     * @return a view of 'length' bytes starting at 'offset', limited to this view
+     */
+    MobiusSpan sub(uint16_t offset, uint16_t length) const {
+        if (offset > _size) offset = _size;
+        if (length > _size - offset) length = _size - offset;
+        return MobiusSpan(_data + offset, length);
+    }
+
+private:
+    const uint8_t* _data;
+    uint16_t _size;
+};
+
+#endif
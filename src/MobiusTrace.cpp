@@ -0,0 +1,102 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include <Arduino.h>
+#include "MobiusTrace.h"
+#include "MobiusAddress.h"
+#include "MobiusDevice.h"
+
+MobiusTrace::Sink MobiusTrace::_sink = nullptr;
+MobiusTrace::Level MobiusTrace::_level = MobiusTrace::LEVEL_INFO;
+
+/*!
+ * @brief Set the trace sink.
+ *
+ * Events of the given 'level' and less detailed ones are passed to
+ * the given 'sink', null discards all events.
+ */
+void MobiusTrace::setSink(Sink sink, Level level) {
+    _sink = sink;
+    _level = level;
+}
+/*!
+ * @brief Sink logging readable events to "Serial".
+ *
+ * Data is logged as an address ("aa:bb:cc:dd:ee:ff") for connection phases
+ * and in hex for request phases.
+ */
+void MobiusTrace::serialSink(const MobiusTraceEvent& event, MobiusSpan data) {
+    Serial.print(event.micros);
+    Serial.print(' ');
+    Serial.print(phaseName(event.phase));
+    if (event.messageId) {
+        Serial.print(" id:");
+        Serial.print(event.messageId);
+    }
+    Serial.print(" size:");
+    Serial.print(event.size);
+    if (PHASE_REQUEST_SENT > event.phase && MobiusAddress::SIZE == data.size()) {
+        Serial.print(' ');
+        Serial.print(MobiusAddress(data.data()).toString());
+    }
+    else if (PHASE_REQUEST_SENT <= event.phase) {
+        for (uint16_t i = 0; i < data.size(); i++) {
+            Serial.print(" 0x");
+            Serial.print(data[i], HEX);
+        }
+    }
+    Serial.println();
+}
+/*!
+ * @return the name of the given 'phase'
+ */
+const char* MobiusTrace::phaseName(uint8_t phase) {
+    switch (phase) {
+        case PHASE_SCAN: return "scan";
+        case PHASE_SCAN_FOUND: return "scan found";
+        case PHASE_SCAN_DONE: return "scan done";
+        case PHASE_SCAN_FAILED: return "scan failed";
+        case PHASE_NOT_FOUND: return "not found";
+        case PHASE_CONNECT: return "connect";
+        case PHASE_CONNECTED: return "connected";
+        case PHASE_CONNECT_FAILED: return "connect failed";
+        case PHASE_DISCOVERED: return "discovered";
+        case PHASE_DISCOVER_FAILED: return "discover failed";
+        case PHASE_CHARACTERISTICS: return "characteristics";
+        case PHASE_CONNECTION_LOST: return "connection lost";
+        case PHASE_REQUEST_SENT: return "request sent";
+        case PHASE_SEND_FAILED: return "send failed";
+        case PHASE_FRAGMENT: return "fragment";
+        case PHASE_RESPONSE: return "response";
+        case PHASE_CRC_INVALID: return "crc invalid";
+        case PHASE_NO_ASSEMBLER: return "no assembler";
+        case PHASE_REQUEST_SUCCESSFUL: return "request successful";
+        case PHASE_REQUEST_FAILED: return "request failed";
+        case PHASE_NOTIFICATION: return "notification";
+        default: return "unknown";
+    }
+}
+/*!
+ * Pass an event of the given 'level' and 'phase' to the sink. Called
+ * through MOBIUS_TRACE() so disabled levels are compiled out.
+ */
+void MobiusTrace::trace(Level level, Phase phase, uint16_t messageId, uint16_t size, MobiusSpan data) {
+    Sink sink = _sink;
+    Level enabled = _level;
+    if (!sink && MobiusDevice::debug) {
+        // legacy debug logging
+        sink = serialSink;
+        enabled = LEVEL_DEBUG;
+    }
+    if (!sink || level > enabled) {
+        return;
+    }
+    MobiusTraceEvent event;
+    event.micros = micros();
+    event.messageId = messageId;
+    event.size = size;
+    event.phase = phase;
+    event.level = level;
+    sink(event, data);
+}
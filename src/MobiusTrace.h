@@ -0,0 +1,125 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusTrace_h
+#define _MobiusTrace_h
+
+#include <cstdint>
+#include "MobiusSpan.h"
+
+#define MOBIUS_TRACE_NONE 0
+#define MOBIUS_TRACE_ERROR 1
+#define MOBIUS_TRACE_INFO 2
+#define MOBIUS_TRACE_DEBUG 3
+
+#ifndef MOBIUS_TRACE_LEVEL
+/*!
+ * Most detailed trace level compiled in, events of more detailed levels
+ * are removed at compile time. MOBIUS_TRACE_NONE removes all tracing.
+ */
+#define MOBIUS_TRACE_LEVEL MOBIUS_TRACE_DEBUG
+#endif
+
+/*!
+ * Emit a trace event of the given 'level' and 'phase' (e.g. LEVEL_INFO, PHASE_SCAN),
+ * unless the level is compiled out by MOBIUS_TRACE_LEVEL. Further arguments are
+ * the message ID, byte count and optionally a MobiusSpan of data.
+ */
+#define MOBIUS_TRACE(level, phase, ...) \
+    do { if (MobiusTrace::level <= MOBIUS_TRACE_LEVEL) MobiusTrace::trace(MobiusTrace::level, MobiusTrace::phase, __VA_ARGS__); } while (0)
+
+/*!
+ * @brief Binary record of a single trace event.
+ */
+struct MobiusTraceEvent {
+    uint32_t micros;    // timestamp
+    uint16_t messageId; // request the event belongs to, 0 if none
+    uint16_t size;      // byte count (or count) the event reports
+    uint8_t phase;      // MobiusTrace::Phase
+    uint8_t level;      // MobiusTrace::Level
+};
+
+/*!
+ * @brief Mobius class for tracing.
+ *
+ * This utility class hands trace events of the connection and request
+ * phases to a pluggable sink. Without a sink events are discarded (and
+ * cost a single check), unless MobiusDevice::debug is set, which logs
+ * every event to "Serial".
+ */
+class MobiusTrace {
+public:
+    enum Level : uint8_t {
+        LEVEL_ERROR = MOBIUS_TRACE_ERROR,
+        LEVEL_INFO = MOBIUS_TRACE_INFO,
+        LEVEL_DEBUG = MOBIUS_TRACE_DEBUG
+    };
+
+    /*!
+     * Phases reported by trace events. Connection phases carry the device
+     * address (MobiusAddress bytes) as data, request phases the frame bytes.
+     */
+    enum Phase : uint8_t {
+        PHASE_SCAN,                 // scan started
+        PHASE_SCAN_FOUND,           // device found
+        PHASE_SCAN_DONE,            // scan complete, size is the number of devices found
+        PHASE_SCAN_FAILED,          // scan couldn't be started
+        PHASE_NOT_FOUND,            // device not found
+        PHASE_CONNECT,              // connecting to a device
+        PHASE_CONNECTED,            // connected to a device
+        PHASE_CONNECT_FAILED,       // couldn't connect to a device
+        PHASE_DISCOVERED,           // service and characteristics discovered
+        PHASE_DISCOVER_FAILED,      // service or characteristics not discovered
+        PHASE_CHARACTERISTICS,      // size is the number of characteristics found (of 3)
+        PHASE_CONNECTION_LOST,      // connection lost
+        PHASE_REQUEST_SENT,         // request written
+        PHASE_SEND_FAILED,          // request couldn't be written
+        PHASE_FRAGMENT,             // RX_DATA fragment received, size is the response size so far
+        PHASE_RESPONSE,             // response complete
+        PHASE_CRC_INVALID,          // response rejected, its CRC doesn't match
+        PHASE_NO_ASSEMBLER,         // fragment dropped, no free assembler
+        PHASE_REQUEST_SUCCESSFUL,   // request complete, size is the response data size
+        PHASE_REQUEST_FAILED,       // request failed or timed out
+        PHASE_NOTIFICATION          // unsolicited update, size is the data size
+    };
+
+    /*!
+     * Function receiving trace events and (possibly empty) data belonging to them.
+     * The data is only valid during the call.
+     */
+    typedef void (*Sink)(const MobiusTraceEvent& event, MobiusSpan data);
+
+    /*!
+     * @brief Set the trace sink.
+     *
+     * Events of the given 'level' and less detailed ones are passed to
+     * the given 'sink', null discards all events.
+     */
+    static void setSink(Sink sink, Level level = LEVEL_INFO);
+
+    /*!
+     * @brief Sink logging readable events to "Serial".
+     *
+     * Data is logged as an address ("aa:bb:cc:dd:ee:ff") for connection phases
+     * and in hex for request phases.
+     */
+    static void serialSink(const MobiusTraceEvent& event, MobiusSpan data);
+
+    /*!
+     * @return the name of the given 'phase'
+     */
+    static const char* phaseName(uint8_t phase);
+
+    /*!
+     * Pass an event of the given 'level' and 'phase' to the sink. Called
+     * through MOBIUS_TRACE() so disabled levels are compiled out.
+     */
+    static void trace(Level level, Phase phase, uint16_t messageId, uint16_t size, MobiusSpan data = MobiusSpan());
+
+private:
+    static Sink _sink;
+    static Level _level;
+};
+
+#endif
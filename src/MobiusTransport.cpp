@@ -0,0 +1,20 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#include "MobiusTransport.h"
+#include "MobiusDevice.h"
+
+/*!
+ * Hand the given RX_DATA 'fragment' (of size 'length') to the 'device'.
+ */
+void MobiusTransport::deliverData(MobiusDevice& device, const uint8_t* fragment, uint16_t length) {
+    device.dataReceived(device.receiveFragment(fragment, length, MobiusCapture::TYPE_DATA));
+}
+/*!
+ * Hand the given RX_FINAL 'fragment' (of size 'length') to the 'device',
+ * completing the response.
+ */
+void MobiusTransport::deliverFinal(MobiusDevice& device, const uint8_t* fragment, uint16_t length) {
+    device.responseReceived(device.receiveFragment(fragment, length, MobiusCapture::TYPE_FINAL));
+}
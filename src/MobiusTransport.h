@@ -0,0 +1,67 @@
+/*!
+ * This file is part of the MobiusBLE library.
+ */
+
+#ifndef _MobiusTransport_h
+#define _MobiusTransport_h
+
+#include <cstdint>
+
+class MobiusDevice;
+
+/*!
+ * @brief Mobius interface for carrying frames to and from a device.
+ *
+ * By default a MobiusDevice writes requests to the Mobius characteristics
+ * through ArduinoBLE. A transport set with MobiusDevice::setTransport()
+ * replaces that path, e.g. with a MobiusSimulator for benchmarks without
+ * a radio. A transport hands the response fragments it receives to the
+ * device with deliverData() and deliverFinal().
+ */
+class MobiusTransport {
+public:
+    virtual ~MobiusTransport() { }
+
+    /*!
+     * Connect the given 'device', which response fragments are delivered to.
+     *
+     * @return true if connected
+     */
+    virtual bool connect(MobiusDevice& device) = 0;
+
+    /*!
+     * Disconnect the connected device.
+     */
+    virtual void disconnect() = 0;
+
+    /*!
+     * @return true if a device is connected
+     */
+    virtual bool connected() = 0;
+
+    /*!
+     * Write the given request 'frame' (of size 'length').
+     *
+     * @return true if the request was written
+     */
+    virtual bool write(const uint8_t* frame, uint16_t length) = 0;
+
+    /*!
+     * Process pending events, delivering any received fragments.
+     */
+    virtual void poll() = 0;
+
+protected:
+    /*!
+     * Hand the given RX_DATA 'fragment' (of size 'length') to the 'device'.
+     */
+    static void deliverData(MobiusDevice& device, const uint8_t* fragment, uint16_t length);
+
+    /*!
+     * Hand the given RX_FINAL 'fragment' (of size 'length') to the 'device',
+     * completing the response.
+     */
+    static void deliverFinal(MobiusDevice& device, const uint8_t* fragment, uint16_t length);
+};
+
+#endif